@@ -0,0 +1,110 @@
+#include "../src/includes/Core.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace PassCurses;
+
+using JSON = nlohmann::json;
+
+
+namespace {
+
+    const int BENCH_KEY = 5;
+
+
+    /*
+     * A vault of generated entries, encrypted like a real one
+     */
+    JSON
+    make_vault(std::size_t entries) {
+        JSON j = JSON::object();
+        for (std::size_t i = 0; i < entries; i++) {
+            const auto name = "account-" + std::to_string(i) + "@example.com";
+            j[encrypt(name, BENCH_KEY)] = encrypt(random_password(20), BENCH_KEY);
+        }
+
+        return j;
+    }
+
+
+    /*
+     * Best of repeats runs, in seconds
+     */
+    template <typename Run>
+    double
+    best_time(int repeats, Run run) {
+        auto best = 0.0;
+        for (auto i = 0; i < repeats; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+            if (i == 0 || took.count() < best) best = took.count();
+        }
+
+        return best;
+    }
+}
+
+
+/*
+ * Saves and loads a generated vault in both formats through the library's own vault files,
+ * then looks up one entry in the compressed one.
+ * usage: vault_bench [entries] [repeats]
+ */
+int main(int argc, char *argv[])
+{
+    const auto entries = argc > 1 ? std::max<std::size_t>(1, std::stoul(argv[1])) : 100000;
+    const auto repeats = argc > 2 ? std::max(1, std::stoi(argv[2])) : 5;
+
+    // Everything is written to a scratch vault directory, never to ~/.passcurses
+    VAULT_DIRECTORY = (fs::temp_directory_path() / ("passcurses-bench-" + std::to_string(getpid()))).string();
+    fs::create_directories(VAULT_DIRECTORY);
+
+    auto j = make_vault(entries);
+    std::uintmax_t plain_size = 0;
+
+    std::printf("%zu entries, best of %d\n", entries, repeats);
+    std::printf("%-12s %12s %8s %12s %12s\n", "format", "bytes", "ratio", "save MB/s", "load MB/s");
+    for (auto compressed : {false, true}) {
+        const auto save = best_time(repeats, [&]() {
+            COMPRESSED_STORAGE = compressed;
+            write_to_file(j, BENCH_KEY);
+        });
+        const auto size = fs::file_size(vault_file_path());
+        if (!compressed) plain_size = size;
+
+        JSON loaded;
+        const auto load = best_time(repeats, [&]() {
+            std::ifstream instream(vault_file_path(), std::ios::binary);
+            if (!load_vault(instream, BENCH_KEY, loaded)) {
+                std::cerr << "VAULT DID NOT LOAD BACK!" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        });
+        if (loaded != j) {
+            std::cerr << "VAULT CHANGED ON THE WAY THROUGH!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // Throughput is over the plain JSON size, so both formats are measured on the same data
+        const auto megabytes = static_cast<double>(plain_size) / (1024 * 1024);
+        std::printf("%-12s %12ju %8.2f %12.1f %12.1f\n", compressed ? "compressed" : "plain", size,
+                    static_cast<double>(plain_size) / static_cast<double>(size), megabytes / save, megabytes / load);
+    }
+
+    // Random access: a compressed vault answers one name by decoding the block holding it
+    const auto key = std::next(j.begin(), static_cast<std::ptrdiff_t>(entries / 2)).key();
+    std::string value;
+    const auto lookup = best_time(repeats, [&]() {
+        if (!lookup_entry(key, BENCH_KEY, value) || value != j[key]) {
+            std::cerr << "LOOKUP MISSED!" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    });
+    std::printf("single-entry lookup %.3f ms\n", lookup * 1000);
+
+    fs::remove_all(VAULT_DIRECTORY);
+
+    return 0;
+}
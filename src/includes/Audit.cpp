@@ -0,0 +1,483 @@
+#include "Audit.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+using JSON = nlohmann::json;
+
+const double      PassCurses::AUDIT_WEAK_BITS  = 40.0;
+const std::size_t PassCurses::AUDIT_MIN_LENGTH = 8;
+
+namespace {
+
+    /*
+     * Common passwords and words, sorted and front-coded: each word starts with the
+     * number of leading characters it shares with the previous one
+     */
+    const char *const DICTIONARY =
+    "0abc 1ccess 1dmin 5istrator 1manda 1ndrew 2gel 1pple 2ril 1rsenal 1shley 2shole 1ugust "
+    "2tumn 0baby 4girl 2ckup 2iley 2nana 2seball 3ketball 2tman 1erlin 1itch 3eme 1lack 2ink "
+    "2ue 1rother 1uddy 2ster 2tterfly 0changeme 3rlie 2eese 3lsea 2ocolate 2rist 1isco "
+    "1offee 2mpany 4uter 2okie 2rvette 1rystal 0dakota 2llas 2niel 2tabase 1ecember 2fault "
+    "1iamond 1onald 1ragon 0eagle 0facebook 2lcon 2mily 2ther 1ebruary 2rrari 1lower "
+    "1ootball 2rever 1reedom 2iday 3end 1uckyou 0game 4r 4s 1eorge 1inger 1olden 2ogle 1reen "
+    "1uest 0hammer 2nnah 2rley 1eaven 2llo 1ockey 1ulk 2nter 0iloveyou 1nternet 1ronman "
+    "0january 2smine 1ennifer 2ssica 3us 1ordan 2shua 1unior 0killer 1night 0letme 5in "
+    "1inkedin 2on 2verpool 1ogin 2ndon 2ve 4ly 4r 0maggie 3ic 2nager 2rch 3vel 2ster 2trix "
+    "3thew 2verick 1ichael 3key 2nnie 1onday 3ey 3key 2ther 1ustang 1ysql 0network 1icole "
+    "2nja 3tendo 1ovember 0october 1ffice 1racle 3nge 0paris 2ss 4w 5ord 1epper 1hoenix "
+    "1layer 1okemon 2stgres 1rincesa 7s 3vate 1ublic 2rple 0qazwsx 1wer 4ty 0rainbow 2nger "
+    "1ed 1obert 2cket 2ot 2uter 0samsung 1ecret 3ure 5ity 2rver 4ice 1hadow 1ilver 2ster "
+    "1noopy 1occer 2phie 1pider 6man 2ring 1tarwars 1ummer 2nday 3shine 2perman 3port 1ystem "
+    "0teamo 2mp 4orary 2st 1homas 2under 1iger 3ger 1oor 1rustno 1witter 0user 4s 0viking "
+    "0warrior 1elcome 1hatever 2ite 1ifi 2nter 2zard 1orld 0yahoo 2nkees 1ellow 0zaq ";
+
+
+    /*
+     * Array-packed trie of the dictionary; each node's children sit next to each
+     * other in edges, sorted by character
+     */
+    struct CompactTrie {
+        struct Node { std::uint32_t first_edge; std::uint16_t edge_count; bool terminal; };
+        struct Edge { char ch; std::uint32_t child; };
+
+        std::vector<Node> nodes;
+        std::vector<Edge> edges;
+        std::size_t       word_count = 0;
+    };
+
+
+    /*
+     * Expands the front-coded dictionary and packs it into a trie, breadth first
+     */
+    CompactTrie
+    build_trie() {
+        std::vector<std::string> words;
+        std::string previous;
+        const std::string encoded(DICTIONARY);
+        std::size_t pos = 0;
+        while (pos < encoded.size()) {
+            const auto end = encoded.find(' ', pos);
+            const auto token = encoded.substr(pos, end - pos);
+            pos = (end == std::string::npos) ? encoded.size() : end + 1;
+            if (token.empty()) continue;
+            previous = previous.substr(0, token[0] - '0') + token.substr(1);
+            words.push_back(previous);
+        }
+
+        // Words are sorted, so each node's words form a contiguous range
+        struct Pending { std::size_t begin, end, depth; };
+        CompactTrie trie;
+        trie.word_count = words.size();
+        std::vector<Pending> queue {{0, words.size(), 0}};
+        trie.nodes.push_back({0, 0, false});
+        for (std::size_t n = 0; n < queue.size(); n++) {
+            auto [begin, end, depth] = queue[n];
+            if (begin < end && words[begin].size() == depth) {
+                trie.nodes[n].terminal = true;
+                begin++;
+            }
+            trie.nodes[n].first_edge = static_cast<std::uint32_t>(trie.edges.size());
+            for (auto i = begin; i < end;) {
+                const auto ch = words[i][depth];
+                auto k = i;
+                while (k < end && words[k][depth] == ch) k++;
+                trie.edges.push_back({ch, static_cast<std::uint32_t>(queue.size())});
+                trie.nodes.push_back({0, 0, false});
+                queue.push_back({i, k, depth + 1});
+                i = k;
+            }
+            trie.nodes[n].edge_count = static_cast<std::uint16_t>(trie.edges.size() - trie.nodes[n].first_edge);
+        }
+
+        return trie;
+    }
+
+
+    const CompactTrie &
+    dictionary_trie() {
+        static const CompactTrie trie = build_trie();
+        return trie;
+    }
+
+
+    inline std::uint64_t
+    rotl(std::uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+
+    inline void
+    sip_round(std::uint64_t &v0, std::uint64_t &v1, std::uint64_t &v2, std::uint64_t &v3) {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    }
+
+
+    /*
+     * Lowercases and undoes common leetspeak so word matches line up with the original positions
+     */
+    std::string
+    normalise(const std::string &password) {
+        std::string out(password);
+        for (auto &ch : out) {
+            switch (ch) {
+                case '0': ch = 'o'; break;
+                case '1': ch = 'i'; break;
+                case '3': ch = 'e'; break;
+                case '4': case '@': ch = 'a'; break;
+                case '5': case '$': ch = 's'; break;
+                case '7': ch = 't'; break;
+                default:  ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+            }
+        }
+
+        return out;
+    }
+
+
+    /*
+     * The part of a password people keep when they "rotate" it: normalised, without trailing digits or symbols
+     */
+    std::string
+    skeleton(const std::string &password) {
+        auto end = password.size();
+        while (end > 0 && !std::isalpha(static_cast<unsigned char>(password[end-1]))) end--;
+
+        return normalise(password.substr(0, end));
+    }
+
+
+    const char *const KEYBOARD_ROWS[] = {"1234567890", "qwertyuiop", "asdfghjkl", "zxcvbnm"};
+
+
+    /*
+     * Length of the keyboard-row walk starting at i, forwards or backwards
+     */
+    std::size_t
+    keyboard_run(const std::string &lower, std::size_t i) {
+        std::size_t best = 0;
+        for (const auto *row : KEYBOARD_ROWS) {
+            const std::string_view keys(row);
+            for (int direction : {1, -1}) {
+                auto at = keys.find(lower[i]);
+                if (at == std::string_view::npos) continue;
+                std::size_t length = 1;
+                while (i + length < lower.size()) {
+                    const auto next = static_cast<long>(at) + direction;
+                    if (next < 0 || next >= static_cast<long>(keys.size()) || keys[next] != lower[i + length]) break;
+                    at = next;
+                    length++;
+                }
+                best = std::max(best, length);
+            }
+        }
+
+        return best;
+    }
+
+
+    /*
+     * Length of the ascending or descending run (abc, 321) starting at i
+     */
+    std::size_t
+    sequence_run(const std::string &lower, std::size_t i) {
+        std::size_t best = 1;
+        for (int step : {1, -1}) {
+            std::size_t length = 1;
+            while (i + length < lower.size() && lower[i + length] - lower[i + length - 1] == step &&
+                   std::isalnum(static_cast<unsigned char>(lower[i + length]))) length++;
+            best = std::max(best, length);
+        }
+
+        return best;
+    }
+
+
+    std::size_t
+    repeat_run(const std::string &password, std::size_t i) {
+        std::size_t length = 1;
+        while (i + length < password.size() && password[i + length] == password[i]) length++;
+
+        return length;
+    }
+}
+
+
+/*
+ * 64-bit SipHash-2-4 of data under a 128-bit key
+ */
+std::uint64_t
+PassCurses::siphash(std::string_view data, std::uint64_t k0, std::uint64_t k1) {
+    std::uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    std::uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    std::uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    std::uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const auto length = data.size();
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data.data());
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t m = 0;
+        for (auto b = 0; b < 8; b++) m |= static_cast<std::uint64_t>(bytes[i + b]) << (8 * b);
+        v3 ^= m;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    std::uint64_t last = static_cast<std::uint64_t>(length & 0xff) << 56;
+    for (auto b = 0; i + b < length; b++) last |= static_cast<std::uint64_t>(bytes[i + b]) << (8 * b);
+    v3 ^= last;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (auto r = 0; r < 4; r++) sip_round(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+
+/*
+ * Estimates how many bits of guessing a password takes, using the embedded
+ * dictionary and common patterns; reason is set to the weakest pattern found
+ */
+double
+PassCurses::password_entropy(const std::string &password, std::string &reason) {
+    const auto length = password.size();
+    reason.clear();
+    if (length == 0) {
+        reason = "empty";
+        return 0;
+    }
+
+    // Brute force cost per character depends on which classes the password draws from
+    auto lower = false, upper = false, digit = false, symbol = false;
+    for (unsigned char ch : password) {
+        if (std::islower(ch)) lower = true;
+        else if (std::isupper(ch)) upper = true;
+        else if (std::isdigit(ch)) digit = true;
+        else symbol = true;
+    }
+    const auto charset   = (lower ? 26 : 0) + (upper ? 26 : 0) + (digit ? 10 : 0) + (symbol ? 33 : 0);
+    const auto char_bits = std::log2(static_cast<double>(charset));
+
+    const auto &trie      = dictionary_trie();
+    const auto word_bits  = std::log2(static_cast<double>(trie.word_count));
+    const auto normalised = normalise(password);
+    std::string lowered(password);
+    for (auto &ch : lowered) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+
+    // Cheapest way to cover each prefix, with the pattern that ended it
+    std::vector<double>      cost(length + 1, 1e9);
+    std::vector<std::size_t> from_of(length + 1, 0);
+    std::vector<const char *> pattern(length + 1, nullptr);
+    cost[0] = 0;
+    auto relax = [&](std::size_t from, std::size_t to, double bits, const char *what) {
+        if (cost[from] + bits < cost[to]) {
+            cost[to]    = cost[from] + bits;
+            from_of[to] = from;
+            pattern[to] = what;
+        }
+    };
+
+    for (std::size_t i = 0; i < length; i++) {
+        relax(i, i + 1, char_bits, nullptr);
+
+        // Every dictionary word starting here
+        std::uint32_t node = 0;
+        for (auto k = i; k < length; k++) {
+            const auto &n = trie.nodes[node];
+            auto edge = trie.edges.begin() + n.first_edge;
+            const auto edge_end = edge + n.edge_count;
+            while (edge != edge_end && edge->ch != normalised[k]) ++edge;
+            if (edge == edge_end) break;
+            node = edge->child;
+            if (!trie.nodes[node].terminal) continue;
+
+            const auto size = k - i + 1;
+            const auto variations = (password.compare(i, size, lowered, i, size) != 0 ? 1.0 : 0.0) +
+                                    (lowered.compare(i, size, normalised, i, size) != 0 ? 1.0 : 0.0);
+            relax(i, k + 1, word_bits + variations, "dictionary word");
+        }
+
+        if (const auto run = repeat_run(password, i); run >= 3) {
+            relax(i, i + run, char_bits + std::log2(static_cast<double>(run)), "repeated characters");
+        }
+        if (const auto run = sequence_run(lowered, i); run >= 3) {
+            relax(i, i + run, std::log2(36.0 * 2) + std::log2(static_cast<double>(run)), "sequence");
+        }
+        if (const auto run = keyboard_run(lowered, i); run >= 3) {
+            relax(i, i + run, std::log2(80.0) + std::log2(static_cast<double>(run)), "keyboard pattern");
+        }
+        if (i + 4 <= length && std::all_of(password.begin() + i, password.begin() + i + 4,
+                                           [](unsigned char ch) { return std::isdigit(ch); })) {
+            const auto year = std::stoi(password.substr(i, 4));
+            if (year >= 1900 && year < 2040) relax(i, i + 4, std::log2(140.0), "year");
+        }
+    }
+
+    // Report the longest pattern on the cheapest path
+    std::size_t longest = 0;
+    for (auto end = length; end > 0; end = from_of[end]) {
+        if (pattern[end] && end - from_of[end] > longest) {
+            longest = end - from_of[end];
+            reason  = pattern[end];
+            if (reason == "dictionary word") reason += " '" + normalised.substr(from_of[end], longest) + "'";
+        }
+    }
+    if (reason.empty() && length < AUDIT_MIN_LENGTH) reason = "too short";
+    if (reason.empty()) reason = "low entropy";
+
+    return cost[length];
+}
+
+
+/*
+ * Decrypts every value in parallel batches, groups reused passwords by keyed hash and scores strength.
+ * Passwords are also looked up in the breach index when one is open
+ */
+PassCurses::AuditReport
+PassCurses::audit_vault(const JSON &j, const int &CYPHER_KEY, const BreachIndex *breaches) {
+    const auto started = std::chrono::steady_clock::now();
+
+    AuditReport report;
+    report.entries = j.size();
+
+    std::vector<const std::string *> keys;
+    std::vector<const std::string *> values;
+    keys.reserve(j.size());
+    values.reserve(j.size());
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        keys.push_back(&it.key());
+        values.push_back(&it.value().get_ref<const std::string &>());
+    }
+
+    // A fresh key per audit, so the hashes mean nothing outside this run
+    std::random_device rd;
+    const std::uint64_t k0 = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+    const std::uint64_t k1 = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+
+    const auto count = keys.size();
+    std::vector<std::uint64_t> exact(count), loose(count);
+    std::vector<double>        bits(count);
+    std::vector<std::string>   reasons(count);
+    std::vector<char>          short_loose(count), too_short(count);
+    std::vector<std::uint32_t> breach_counts(count, 0);
+    const auto check_breaches = breaches && breaches->is_open();
+
+    const auto thread_count = std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(), count / 256 + 1));
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < thread_count; t++) {
+        workers.emplace_back([&, t]() {
+            const auto begin = count * t / thread_count;
+            const auto end   = count * (t + 1) / thread_count;
+            for (auto i = begin; i < end; i++) {
+                const auto password = decrypt(*values[i], CYPHER_KEY);
+                const auto base     = skeleton(password);
+                exact[i]       = siphash(password, k0, k1);
+                loose[i]       = siphash(base, k0, k1);
+                short_loose[i] = base.size() < 4;  // Too little left to call two passwords related
+                bits[i]        = password_entropy(password, reasons[i]);
+                too_short[i]   = password.size() < AUDIT_MIN_LENGTH;
+                if (too_short[i] && bits[i] >= AUDIT_WEAK_BITS) reasons[i] = "too short";
+                if (check_breaches) breach_counts[i] = breaches->occurrences(sha1(password));
+            }
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    // Grouping is a single pass over hashes instead of comparing every pair
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> exact_groups, loose_groups;
+    for (std::size_t i = 0; i < count; i++) {
+        exact_groups[exact[i]].push_back(i);
+        if (!short_loose[i]) loose_groups[loose[i]].push_back(i);
+    }
+
+    for (auto& [hash, members] : exact_groups) {
+        if (members.size() < 2) continue;
+        std::vector<std::string> group;
+        for (auto i : members) group.push_back(*keys[i]);
+        report.reused.push_back(std::move(group));
+    }
+    for (auto& [hash, members] : loose_groups) {
+        // Groups made up of one identical password are already reported as reuse
+        const auto first = exact[members.front()];
+        if (members.size() < 2 ||
+            std::all_of(members.begin(), members.end(), [&](std::size_t i) { return exact[i] == first; })) continue;
+        std::vector<std::string> group;
+        for (auto i : members) group.push_back(*keys[i]);
+        report.similar.push_back(std::move(group));
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        if (bits[i] < AUDIT_WEAK_BITS || too_short[i]) {
+            report.weak.push_back({*keys[i], bits[i], reasons[i]});
+        }
+        if (breach_counts[i]) report.breached.emplace_back(*keys[i], breach_counts[i]);
+    }
+
+    // Largest groups and weakest passwords first
+    auto by_size = [](const auto &a, const auto &b) { return a.size() > b.size() || (a.size() == b.size() && a < b); };
+    std::sort(report.reused.begin(), report.reused.end(), by_size);
+    std::sort(report.similar.begin(), report.similar.end(), by_size);
+    std::sort(report.weak.begin(), report.weak.end(),
+              [](const WeakPassword &a, const WeakPassword &b) { return a.entropy_bits < b.entropy_bits; });
+    std::sort(report.breached.begin(), report.breached.end(),
+              [](const auto &a, const auto &b) { return a.second > b.second; });
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    return report;
+}
+
+
+/*
+ * Renders the report as plain lines with decrypted key names, shared by the TUI and headless output
+ */
+std::vector<std::string>
+PassCurses::format_audit_report(const AuditReport &report, const int &CYPHER_KEY) {
+    std::vector<std::string> lines;
+    char buffer[128];
+    std::snprintf(buffer, sizeof buffer, "%zu entries audited in %.3fs", report.entries, report.seconds);
+    lines.emplace_back(buffer);
+
+    auto add_groups = [&](const char *title, const std::vector<std::vector<std::string>> &groups) {
+        lines.emplace_back("");
+        lines.push_back(std::string(title) + " (" + std::to_string(groups.size()) + ")");
+        for (auto &group : groups) {
+            std::string line = "  ";
+            for (std::size_t i = 0; i < group.size(); i++) {
+                if (i) line += ", ";
+                line += decrypt(group[i], CYPHER_KEY);
+            }
+            lines.push_back(line);
+        }
+    };
+    lines.emplace_back("");
+    lines.push_back("Breached passwords (" + std::to_string(report.breached.size()) + ")");
+    for (auto& [key, occurrences] : report.breached) {
+        std::snprintf(buffer, sizeof buffer, "  %s: seen %u times", decrypt(key, CYPHER_KEY).c_str(), occurrences);
+        lines.emplace_back(buffer);
+    }
+
+    add_groups("Reused passwords", report.reused);
+    add_groups("Similar passwords", report.similar);
+
+    lines.emplace_back("");
+    lines.push_back("Weak passwords (" + std::to_string(report.weak.size()) + ")");
+    for (auto &weak : report.weak) {
+        std::snprintf(buffer, sizeof buffer, "  %s: %.0f bits, %s",
+                      decrypt(weak.key, CYPHER_KEY).c_str(), weak.entropy_bits, weak.reason.c_str());
+        lines.emplace_back(buffer);
+    }
+
+    return lines;
+}
@@ -0,0 +1,67 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json.hpp"
+#include "Breach.hpp"
+
+
+namespace PassCurses {
+
+    extern const double AUDIT_WEAK_BITS;
+    extern const std::size_t AUDIT_MIN_LENGTH;
+
+
+    /*
+     * A password that scored below the strength threshold
+     */
+    struct WeakPassword {
+        std::string key;           // Encrypted key of the entry
+        double      entropy_bits;  // Estimated guessing entropy
+        std::string reason;        // Most significant pattern found in it
+    };
+
+
+    /*
+     * Result of auditing the whole vault; keys are left encrypted
+     */
+    struct AuditReport {
+        std::size_t                           entries = 0;
+        std::vector<std::vector<std::string>> reused;   // Keys sharing one identical password
+        std::vector<std::vector<std::string>> similar;  // Keys whose passwords differ only by case, leetspeak or suffix
+        std::vector<WeakPassword>             weak;
+        std::vector<std::pair<std::string, std::uint32_t>> breached;  // Keys found in the breach corpus, with counts
+        double                                seconds = 0;
+    };
+
+
+    /*
+     * 64-bit SipHash-2-4 of data under a 128-bit key
+     */
+    std::uint64_t
+    siphash(std::string_view data, std::uint64_t k0, std::uint64_t k1);
+
+
+    /*
+     * Estimates how many bits of guessing a password takes, using the embedded
+     * dictionary and common patterns; reason is set to the weakest pattern found
+     */
+    double
+    password_entropy(const std::string &password, std::string &reason);
+
+
+    /*
+     * Decrypts every value in parallel batches, groups reused passwords by keyed hash and scores strength.
+     * Passwords are also looked up in the breach index when one is open
+     */
+    AuditReport
+    audit_vault(const nlohmann::json &j, const int &CYPHER_KEY, const BreachIndex *breaches = nullptr);
+
+
+    /*
+     * Renders the report as plain lines with decrypted key names, shared by the TUI and headless output
+     */
+    std::vector<std::string>
+    format_audit_report(const AuditReport &report, const int &CYPHER_KEY);
+}
@@ -0,0 +1,370 @@
+#include "Breach.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <queue>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const std::size_t PassCurses::BREACH_SORT_BUFFER = 64 * 1024 * 1024;  // Bytes of records sorted in memory per run
+
+namespace {
+
+    // The index is built on the machine that reads it, so integers are stored in native byte order
+    const char        BREACH_MAGIC[4] = {'P', 'C', 'B', '1'};
+    const std::size_t FAN_OUT_SIZE    = 65536 + 1;
+    const std::size_t SUFFIX_SIZE     = 18;               // Hash bytes left after the 2-byte fan-out prefix
+    const std::size_t RECORD_SIZE     = SUFFIX_SIZE + 4;  // Suffix and occurrence count
+    const std::size_t HEADER_SIZE     = 4 + 4 + 8;        // Magic, padding, record count
+
+    struct Record {
+        PassCurses::Sha1Digest digest;
+        std::uint32_t          count;
+
+        bool operator<(const Record &other) const { return digest < other.digest; }
+        bool operator>(const Record &other) const { return other.digest < digest; }
+    };
+
+
+    inline std::uint32_t
+    rotl(std::uint32_t x, int b) { return (x << b) | (x >> (32 - b)); }
+
+
+    inline int
+    hex_value(char ch) {
+        if (ch >= '0' && ch <= '9') return ch - '0';
+        if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+        return -1;
+    }
+
+
+    /*
+     * Parses "HEX-SHA1" optionally followed by ":count", as in public breach dumps
+     */
+    bool
+    parse_line(const std::string &line, Record &record) {
+        if (line.size() < 40) return false;
+        for (std::size_t i = 0; i < 20; i++) {
+            const auto high = hex_value(line[2*i]), low = hex_value(line[2*i + 1]);
+            if (high < 0 || low < 0) return false;
+            record.digest[i] = static_cast<std::uint8_t>((high << 4) | low);
+        }
+        record.count = 1;
+        if (line.size() > 41 && line[40] == ':') {
+            record.count = static_cast<std::uint32_t>(std::strtoul(line.c_str() + 41, nullptr, 10));
+        }
+
+        return true;
+    }
+
+
+    bool
+    write_run(std::vector<Record> &buffer, const std::string &path) {
+        std::sort(buffer.begin(), buffer.end());
+        std::ofstream outstream(path, std::ios::binary);
+        for (auto &record : buffer) outstream.write(reinterpret_cast<const char *>(&record), sizeof record);
+        buffer.clear();
+
+        return static_cast<bool>(outstream);
+    }
+}
+
+
+/*
+ * SHA-1 of a message, as used by published breach corpora
+ */
+PassCurses::Sha1Digest
+PassCurses::sha1(const std::string &message) {
+    std::uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string padded(message);
+    padded.push_back(static_cast<char>(0x80));
+    while (padded.size() % 64 != 56) padded.push_back('\0');
+    const std::uint64_t bit_length = static_cast<std::uint64_t>(message.size()) * 8;
+    for (auto i = 7; i >= 0; i--) padded.push_back(static_cast<char>((bit_length >> (8 * i)) & 0xff));
+
+    for (std::size_t chunk = 0; chunk < padded.size(); chunk += 64) {
+        std::uint32_t w[80];
+        for (auto i = 0; i < 16; i++) {
+            const auto *p = reinterpret_cast<const unsigned char *>(padded.data() + chunk + 4*i);
+            w[i] = (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+        }
+        for (auto i = 16; i < 80; i++) w[i] = rotl(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+        auto a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (auto i = 0; i < 80; i++) {
+            std::uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            const auto temp = rotl(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotl(b, 30); b = a; a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    Sha1Digest digest;
+    for (auto i = 0; i < 20; i++) digest[i] = static_cast<std::uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+
+    return digest;
+}
+
+
+/*
+ * Path of the imported breach index
+ */
+std::string
+PassCurses::breach_index_path() {
+    return HOME_DIRECTORY + "/.passcurses/breach.idx";
+}
+
+
+/*
+ * Converts a text dump of "HEX-SHA1[:count]" lines into the binary index.
+ * The dump is sorted in bounded memory with on-disk runs, so it may be far larger than RAM
+ */
+bool
+PassCurses::import_breach_corpus(const std::string &dump_path, const std::string &index_path) {
+    std::ifstream instream(dump_path);
+    if (!instream.is_open()) {
+        std::cerr << "CANNOT OPEN BREACH DUMP!" << std::endl;
+        return false;
+    }
+
+    // Pass 1: sorted runs of at most BREACH_SORT_BUFFER bytes each
+    std::vector<std::string> runs;
+    std::vector<Record> buffer;
+    buffer.reserve(BREACH_SORT_BUFFER / sizeof(Record));
+    std::string line;
+    Record record;
+    while (std::getline(instream, line)) {
+        if (!parse_line(line, record)) continue;
+        buffer.push_back(record);
+        if (buffer.size() * sizeof(Record) >= BREACH_SORT_BUFFER) {
+            runs.push_back(index_path + ".run" + std::to_string(runs.size()));
+            if (!write_run(buffer, runs.back())) return false;
+        }
+    }
+    if (!buffer.empty()) {
+        runs.push_back(index_path + ".run" + std::to_string(runs.size()));
+        if (!write_run(buffer, runs.back())) return false;
+    }
+    instream.close();
+    buffer.shrink_to_fit();
+
+    // Pass 2: merge the runs, folding duplicate hashes together
+    std::ofstream outstream(index_path + ".tmp", std::ios::binary);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE BREACH INDEX!" << std::endl;
+        return false;
+    }
+    std::vector<std::uint64_t> fan_out(FAN_OUT_SIZE, 0);
+    outstream.write(std::string(HEADER_SIZE + FAN_OUT_SIZE * sizeof(std::uint64_t), '\0').data(),
+                    HEADER_SIZE + FAN_OUT_SIZE * sizeof(std::uint64_t));
+
+    std::vector<std::ifstream> inputs;
+    for (auto &run : runs) inputs.emplace_back(run, std::ios::binary);
+    using Head = std::pair<Record, std::size_t>;
+    auto later = [](const Head &a, const Head &b) { return a.first > b.first; };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        if (inputs[i].read(reinterpret_cast<char *>(&record), sizeof record)) heads.push({record, i});
+    }
+
+    std::uint64_t total = 0;
+    auto flush = [&](const Record &out) {
+        outstream.write(reinterpret_cast<const char *>(out.digest.data() + 2), SUFFIX_SIZE);
+        outstream.write(reinterpret_cast<const char *>(&out.count), sizeof out.count);
+        fan_out[((out.digest[0] << 8) | out.digest[1]) + 1]++;
+        total++;
+    };
+
+    auto pending = false;
+    Record current {};
+    while (!heads.empty()) {
+        auto [next, source] = heads.top();
+        heads.pop();
+        if (inputs[source].read(reinterpret_cast<char *>(&record), sizeof record)) heads.push({record, source});
+
+        if (pending && next.digest == current.digest) {
+            current.count += next.count;
+            continue;
+        }
+        if (pending) flush(current);
+        current = next;
+        pending = true;
+    }
+    if (pending) flush(current);
+
+    for (std::size_t i = 1; i < FAN_OUT_SIZE; i++) fan_out[i] += fan_out[i-1];
+
+    outstream.seekp(0);
+    outstream.write(BREACH_MAGIC, 4);
+    outstream.write("\0\0\0\0", 4);
+    outstream.write(reinterpret_cast<const char *>(&total), sizeof total);
+    outstream.write(reinterpret_cast<const char *>(fan_out.data()), FAN_OUT_SIZE * sizeof(std::uint64_t));
+    outstream.close();
+
+    inputs.clear();
+    for (auto &run : runs) fs::remove(run);
+    fs::rename(index_path + ".tmp", index_path);
+
+    return true;
+}
+
+
+PassCurses::BreachIndex::~BreachIndex() {
+    if (data_) munmap(const_cast<std::uint8_t *>(data_), size_);
+}
+
+
+bool
+PassCurses::BreachIndex::open(const std::string &path) {
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    const auto header_bytes = HEADER_SIZE + FAN_OUT_SIZE * sizeof(std::uint64_t);
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < header_bytes) {
+        ::close(fd);
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    const auto *bytes = static_cast<const std::uint8_t *>(mapped);
+    std::uint64_t total;
+    std::memcpy(&total, bytes + 8, sizeof total);
+    if (std::memcmp(bytes, BREACH_MAGIC, 4) != 0 ||
+        header_bytes + total * RECORD_SIZE != static_cast<std::uint64_t>(info.st_size)) {
+        munmap(mapped, info.st_size);
+        return false;
+    }
+
+    // Lookups jump around the file, read-ahead would only waste page cache
+    madvise(mapped, info.st_size, MADV_RANDOM);
+
+    data_    = bytes;
+    size_    = info.st_size;
+    fan_out_ = reinterpret_cast<const std::uint64_t *>(bytes + HEADER_SIZE);
+    records_ = bytes + header_bytes;
+
+    return true;
+}
+
+
+/*
+ * Number of times the hash appears in the corpus, 0 if it doesn't
+ */
+std::uint32_t
+PassCurses::BreachIndex::occurrences(const Sha1Digest &digest) const {
+    if (!data_) return 0;
+
+    const auto bucket = (digest[0] << 8) | digest[1];
+    auto low  = fan_out_[bucket];
+    auto high = fan_out_[bucket + 1];
+    while (low < high) {
+        const auto middle = low + (high - low) / 2;
+        const auto *record = records_ + middle * RECORD_SIZE;
+        const auto order  = std::memcmp(record, digest.data() + 2, SUFFIX_SIZE);
+        if (order == 0) {
+            std::uint32_t count;
+            std::memcpy(&count, record + SUFFIX_SIZE, sizeof count);
+            return count;
+        }
+        if (order < 0) low = middle + 1;
+        else high = middle;
+    }
+
+    return 0;
+}
+
+
+PassCurses::BreachChecker::BreachChecker(const BreachIndex &index)
+    : index_(index), worker_(&BreachChecker::run, this) {}
+
+
+PassCurses::BreachChecker::~BreachChecker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+
+/*
+ * Queues a password for checking under its encrypted key
+ */
+void
+PassCurses::BreachChecker::submit(const std::string &key, const std::string &password) {
+    if (!index_.is_open()) return;
+
+    const auto digest = sha1(password);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.emplace_back(key, digest);
+    }
+    wake_.notify_one();
+}
+
+
+/*
+ * Records a result found elsewhere, e.g. by the audit
+ */
+void
+PassCurses::BreachChecker::mark(const std::string &key, std::uint32_t occurrences) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (occurrences) hits_[key] = occurrences;
+    else hits_.erase(key);
+}
+
+
+/*
+ * Times the entry's password appears in the corpus, 0 if clean or not yet checked
+ */
+std::uint32_t
+PassCurses::BreachChecker::occurrences(const std::string &key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = hits_.find(key);
+
+    return it == hits_.end() ? 0 : it->second;
+}
+
+
+/*
+ * Forgets all results, e.g. when another vault is opened
+ */
+void
+PassCurses::BreachChecker::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+    hits_.clear();
+}
+
+
+void
+PassCurses::BreachChecker::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (stopping_) return;
+
+        auto [key, digest] = std::move(queue_.front());
+        queue_.pop_front();
+
+        // The lookup may fault pages in, so don't hold the lock over it
+        lock.unlock();
+        const auto count = index_.occurrences(digest);
+        lock.lock();
+
+        if (count) hits_[key] = count;
+        else hits_.erase(key);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+
+namespace PassCurses {
+
+    extern const std::size_t BREACH_SORT_BUFFER;
+
+
+    using Sha1Digest = std::array<std::uint8_t, 20>;
+
+
+    /*
+     * SHA-1 of a message, as used by published breach corpora
+     */
+    Sha1Digest
+    sha1(const std::string &message);
+
+
+    /*
+     * Path of the imported breach index
+     */
+    std::string
+    breach_index_path();
+
+
+    /*
+     * Converts a text dump of "HEX-SHA1[:count]" lines into the binary index.
+     * The dump is sorted in bounded memory with on-disk runs, so it may be far larger than RAM
+     */
+    bool
+    import_breach_corpus(const std::string &dump_path, const std::string &index_path);
+
+
+    /*
+     * Read-only view of a breach index through a memory map.
+     *
+     * Layout: magic, record count, a fan-out table of 65537 cumulative counts indexed by
+     * the first two hash bytes, then records of the remaining 18 hash bytes and a count,
+     * sorted by hash. A lookup is one fan-out read and a binary search within the bucket,
+     * touching only a handful of pages.
+     */
+    class BreachIndex {
+    public:
+        BreachIndex() = default;
+        BreachIndex(const BreachIndex &) = delete;
+        BreachIndex &operator=(const BreachIndex &) = delete;
+        ~BreachIndex();
+
+        bool
+        open(const std::string &path);
+
+        bool
+        is_open() const { return data_ != nullptr; }
+
+        /*
+         * Number of times the hash appears in the corpus, 0 if it doesn't
+         */
+        std::uint32_t
+        occurrences(const Sha1Digest &digest) const;
+
+    private:
+        const std::uint8_t  *data_    = nullptr;
+        std::size_t          size_    = 0;
+        const std::uint64_t *fan_out_ = nullptr;
+        const std::uint8_t  *records_ = nullptr;
+    };
+
+
+    /*
+     * Checks passwords against the breach index on a background thread.
+     * Only the SHA-1 leaves the caller's thread, never the password itself
+     */
+    class BreachChecker {
+    public:
+        explicit BreachChecker(const BreachIndex &index);
+        BreachChecker(const BreachChecker &) = delete;
+        BreachChecker &operator=(const BreachChecker &) = delete;
+        ~BreachChecker();
+
+        /*
+         * Queues a password for checking under its encrypted key
+         */
+        void
+        submit(const std::string &key, const std::string &password);
+
+        /*
+         * Records a result found elsewhere, e.g. by the audit
+         */
+        void
+        mark(const std::string &key, std::uint32_t occurrences);
+
+        /*
+         * Times the entry's password appears in the corpus, 0 if clean or not yet checked
+         */
+        std::uint32_t
+        occurrences(const std::string &key) const;
+
+        /*
+         * Forgets all results, e.g. when another vault is opened
+         */
+        void
+        clear();
+
+    private:
+        void
+        run();
+
+        const BreachIndex                                   &index_;
+        mutable std::mutex                                   mutex_;
+        std::condition_variable                              wake_;
+        std::deque<std::pair<std::string, Sha1Digest>>       queue_;
+        std::unordered_map<std::string, std::uint32_t>       hits_;
+        bool                                                 stopping_ = false;
+        std::thread                                          worker_;
+    };
+}
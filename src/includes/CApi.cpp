@@ -0,0 +1,276 @@
+#include "passcurses.h"
+#include "Core.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+using namespace PassCurses;
+
+using JSON = nlohmann::json;
+
+/*
+ * An unlocked vault held by a caller of the C interface
+ */
+struct pc_vault {
+    std::string               name;
+    int                       cypher_key;
+    bool                      compressed;
+    bool                      loaded = false;  // A compressed vault is read whole only once a call needs it
+    JSON                      j;
+    UsageIndex                usage;  // Only read, to rank search results like the TUI does
+    std::vector<std::string>  keys;   // Encrypted keys in order, for pc_name_at; empty when stale
+};
+
+namespace {
+
+    // The vault directory, storage format and field indexes are process-wide
+    std::mutex API_MUTEX;
+
+
+    /*
+     * Points the process-wide vault state at one vault
+     */
+    void
+    switch_to(const std::string &name, bool compressed) {
+        if (name != VAULT_NAME) {
+            select_vault(name);
+            FIELD_STORE.reset();
+        }
+        COMPRESSED_STORAGE = compressed;
+    }
+
+
+    char *
+    copy_out(const std::string &text) {
+        auto *out = static_cast<char *>(std::malloc(text.size() + 1));
+        if (!out) return nullptr;
+        std::memcpy(out, text.c_str(), text.size() + 1);
+
+        return out;
+    }
+
+
+    bool
+    parse_field(const char *name, Field &field) {
+        if (!name) return false;
+        for (auto candidate : ALL_FIELDS) {
+            if (std::strcmp(name, field_name(candidate)) == 0) {
+                field = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    /*
+     * Reads the whole vault the first time a call needs more than one entry
+     */
+    bool
+    load_all(pc_vault &v) {
+        if (v.loaded) return true;
+        std::ifstream instream(vault_file_path(), std::ios::binary);
+        if (!load_vault(instream, v.cypher_key, v.j) || !v.j.is_object()) return false;
+        v.usage.sync(v.j);
+        v.loaded = true;
+
+        return true;
+    }
+
+
+    /*
+     * Runs one call against a vault with the lock held; nothing may throw across the C boundary
+     */
+    template <typename Result, typename Call>
+    Result
+    with_vault(pc_vault *vault, Result failure, Call call) {
+        if (!vault) return failure;
+        std::lock_guard<std::mutex> lock(API_MUTEX);
+        try {
+            switch_to(vault->name, vault->compressed);
+            return call(*vault);
+        } catch (...) {
+            return failure;
+        }
+    }
+}
+
+
+pc_vault *
+pc_open(const char *vault_name, int key, const char *master_password) {
+    const std::string name = (vault_name && *vault_name) ? vault_name : DEFAULT_VAULT;
+    if (!master_password || !valid_vault_name(name)) return nullptr;
+
+    std::lock_guard<std::mutex> lock(API_MUTEX);
+    try {
+        switch_to(name, false);
+        if (!fs::exists(vault_file_path()) || !fs::exists(passrc_path())) return nullptr;
+        if (read_master_password(key) != master_password) return nullptr;
+
+        auto vault = std::make_unique<pc_vault>();
+        vault->name       = name;
+        vault->cypher_key = key;
+        std::ifstream instream(vault_file_path(), std::ios::binary);
+        vault->compressed = is_compressed_vault(instream);
+        std::vector<BlockInfo> blocks;
+        if (vault->compressed && !read_block_index(instream, blocks)) return nullptr;
+        instream.close();
+        vault->usage.load(usage_file_path(), key);
+        // Lookups by name in a compressed vault decode single blocks until something needs it all
+        COMPRESSED_STORAGE = vault->compressed;
+        if (!vault->compressed && !load_all(*vault)) return nullptr;
+
+        return vault.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+
+void
+pc_close(pc_vault *vault) {
+    // Leave the vault file complete for anything that reads it directly
+    with_vault(vault, 0, [](pc_vault &v) {
+        if (v.loaded) compact_vault(v.j, v.cypher_key);
+        return 0;
+    });
+    delete vault;
+}
+
+
+size_t
+pc_count(const pc_vault *vault) {
+    return with_vault(const_cast<pc_vault *>(vault), static_cast<size_t>(0), [](pc_vault &v) {
+        return load_all(v) ? v.j.size() : 0;
+    });
+}
+
+
+char *
+pc_name_at(const pc_vault *vault, size_t index) {
+    return with_vault(const_cast<pc_vault *>(vault), static_cast<char *>(nullptr), [&](pc_vault &v) -> char * {
+        if (!load_all(v) || index >= v.j.size()) return nullptr;
+        if (v.keys.size() != v.j.size()) {
+            v.keys.clear();
+            for (auto it = v.j.begin(); it != v.j.end(); ++it) v.keys.push_back(it.key());
+        }
+
+        return copy_out(decrypt(v.keys[index], v.cypher_key));
+    });
+}
+
+
+char *
+pc_get(pc_vault *vault, const char *name) {
+    if (!name) return nullptr;
+
+    return with_vault(vault, static_cast<char *>(nullptr), [&](pc_vault &v) -> char * {
+        const auto key = encrypt(name, v.cypher_key);
+        std::string value;
+        if (!v.loaded) {
+            if (!lookup_entry(key, v.cypher_key, value)) return nullptr;
+        } else {
+            auto it = v.j.find(key);
+            if (it == v.j.end()) return nullptr;
+            value = it->get<std::string>();
+        }
+
+        return copy_out(decrypt(value, v.cypher_key));
+    });
+}
+
+
+char *
+pc_get_field(pc_vault *vault, const char *name, const char *field) {
+    Field which;
+    if (!name || !parse_field(field, which)) return nullptr;
+
+    return with_vault(vault, static_cast<char *>(nullptr), [&](pc_vault &v) -> char * {
+        auto value = read_field(which, encrypt(name, v.cypher_key), v.cypher_key);
+        if (which == Field::TotpSeed && !value.empty()) value = totp_code(value, std::time(nullptr));
+        if (value.empty()) return nullptr;
+
+        return copy_out(value);
+    });
+}
+
+
+char *
+pc_search(pc_vault *vault, const char *text) {
+    if (!text) return nullptr;
+
+    return with_vault(vault, static_cast<char *>(nullptr), [&](pc_vault &v) -> char * {
+        // An exact name wins, like in find_entry, and needs only its own block
+        std::string unused;
+        if (!v.loaded && lookup_entry(encrypt(text, v.cypher_key), v.cypher_key, unused)) return copy_out(text);
+        if (!load_all(v)) return nullptr;
+
+        const auto found = find_entry(v.j, text, v.cypher_key, v.usage);
+        if (found.empty()) return nullptr;
+
+        return copy_out(decrypt(found, v.cypher_key));
+    });
+}
+
+
+int
+pc_set(pc_vault *vault, const char *name, const char *password) {
+    if (!name || !*name || !password || !*password) return -1;
+
+    return with_vault(vault, -1, [&](pc_vault &v) {
+        if (!load_all(v)) return -1;
+        store_password(v.j, name, password, v.cypher_key);
+        v.keys.clear();
+        return 0;
+    });
+}
+
+
+int
+pc_set_field(pc_vault *vault, const char *name, const char *field, const char *value) {
+    Field which;
+    if (!name || !value || !parse_field(field, which)) return -1;
+
+    return with_vault(vault, -1, [&](pc_vault &v) {
+        const auto key = encrypt(name, v.cypher_key);
+        if (!load_all(v) || !v.j.contains(key)) return -1;
+
+        std::string unused;
+        if (which == Field::TotpSeed && *value && !base32_decode(value, unused)) return -1;
+        FIELD_STORE.column(which).set(key, *value ? encrypt(value, v.cypher_key) : "");
+        return 0;
+    });
+}
+
+
+int
+pc_delete(pc_vault *vault, const char *name) {
+    if (!name) return -1;
+
+    return with_vault(vault, -1, [&](pc_vault &v) {
+        if (!load_all(v) || !delete_entry(v.j, encrypt(name, v.cypher_key), v.cypher_key)) return -1;
+        v.keys.clear();
+        return 0;
+    });
+}
+
+
+char *
+pc_generate(size_t length) {
+    if (length == 0) return nullptr;
+
+    try {
+        return copy_out(random_password(length));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+
+void
+pc_free(char *text) {
+    if (!text) return;
+    explicit_bzero(text, std::strlen(text));
+    std::free(text);
+}
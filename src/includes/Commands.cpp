@@ -0,0 +1,203 @@
+#include "Commands.hpp"
+#include "Core.hpp"
+
+using JSON = nlohmann::json;
+
+const std::size_t PassCurses::COMMAND_LOG_SIZE = 100;
+
+
+namespace {
+
+    std::string
+    stored_field(PassCurses::Field field, const std::string &key) {
+        std::string value;
+        if (!PassCurses::FIELD_STORE.column(field).get(key, value)) return "";
+
+        return value;
+    }
+
+
+    std::string
+    stored_value(const JSON &j, const std::string &key) {
+        auto it = j.find(key);
+
+        return it == j.end() ? "" : it->get<std::string>();
+    }
+}
+
+
+/*
+ * Sets a password, adding the entry if it is new
+ */
+PassCurses::Command
+PassCurses::password_command(const JSON &j, const std::string &key, const std::string &value) {
+    Command command;
+    command.change = Change::Password;
+    command.key    = key;
+    command.before.value = stored_value(j, key);
+    command.after.value  = value;
+
+    return command;
+}
+
+
+/*
+ * Sets one field, an empty value clears it
+ */
+PassCurses::Command
+PassCurses::field_command(const std::string &key, Field field, const std::string &value) {
+    Command command;
+    command.change = Change::Field;
+    command.key    = key;
+    command.field  = field;
+    command.before.fields[static_cast<std::size_t>(field)] = stored_field(field, key);
+    command.after.fields[static_cast<std::size_t>(field)]  = value;
+
+    return command;
+}
+
+
+PassCurses::Command
+PassCurses::groups_command(const GroupTree &groups, const std::string &key,
+                           std::vector<std::string> group, std::vector<std::string> tags) {
+    Command command;
+    command.change = Change::Groups;
+    command.key    = key;
+    command.before.group = groups.group_of(key);
+    command.before.tags  = groups.tags_of(key);
+    command.after.group  = std::move(group);
+    command.after.tags   = std::move(tags);
+
+    return command;
+}
+
+
+/*
+ * Deletes an entry, keeping its password, fields, group, tags and usage to bring back on revert
+ */
+PassCurses::Command
+PassCurses::delete_command(const JSON &j, const GroupTree &groups, const UsageIndex &usage, const std::string &key) {
+    Command command;
+    command.change = Change::Entry;
+    command.key    = key;
+    command.before.value = stored_value(j, key);
+    for (auto field : ALL_FIELDS) command.before.fields[static_cast<std::size_t>(field)] = stored_field(field, key);
+    command.before.group = groups.group_of(key);
+    command.before.tags  = groups.tags_of(key);
+    command.before.usage = usage.stats_of(key);
+
+    return command;
+}
+
+
+/*
+ * Writes the command's after state, or its before state when reverting, and saves it
+ */
+void
+PassCurses::apply_command(JSON &j, GroupTree &groups, const Command &command, bool revert, const int &CYPHER_KEY) {
+    const auto &state = revert ? command.before : command.after;
+    const auto &key   = command.key;
+
+    switch (command.change) {
+        case Change::Password: {
+            // Only adding or removing an entry moves anything in the tree
+            const auto existed = j.contains(key);
+            if (revert) revert_entry(j, key, state.value, CYPHER_KEY);
+            else set_entry(j, key, state.value, CYPHER_KEY);
+            if (existed && !j.contains(key)) groups.erase(key);
+            else if (!existed && j.contains(key)) groups.insert(key);
+            break;
+        }
+        case Change::Field:
+            FIELD_STORE.column(command.field).set(key, state.fields[static_cast<std::size_t>(command.field)]);
+            break;
+        case Change::Groups:
+            groups.set_tags(key, state.tags);
+            groups.set_group(key, state.group);
+            groups.save_entry(groups_file_path(), key);
+            break;
+        case Change::Entry:
+            if (revert) revert_entry(j, key, state.value, CYPHER_KEY);
+            else set_entry(j, key, state.value, CYPHER_KEY);
+            if (state.value.empty()) {
+                FIELD_STORE.erase(key);
+                groups.erase(key);
+            } else {
+                for (auto field : ALL_FIELDS) {
+                    const auto &value = state.fields[static_cast<std::size_t>(field)];
+                    if (!value.empty()) FIELD_STORE.column(field).set(key, value);
+                }
+                groups.set_tags(key, state.tags);
+                groups.set_group(key, state.group);
+                groups.insert(key);
+            }
+            groups.save_entry(groups_file_path(), key);
+            break;
+    }
+}
+
+
+/*
+ * What a command does, e.g. "delete 'github'"
+ */
+std::string
+PassCurses::describe_command(const Command &command, const int &CYPHER_KEY) {
+    const auto name = "'" + decrypt(command.key, CYPHER_KEY) + "'";
+    switch (command.change) {
+        case Change::Password: return (command.before.value.empty() ? "add " : "password of ") + name;
+        case Change::Field:    return std::string(field_name(command.field)) + " of " + name;
+        case Change::Groups:   return "group and tags of " + name;
+        case Change::Entry:    return "delete " + name;
+    }
+
+    return name;
+}
+
+
+/*
+ * Applies a command and records it, dropping whatever was undone before it
+ */
+void
+PassCurses::CommandLog::run(JSON &j, GroupTree &groups, Command command, const int &CYPHER_KEY) {
+    apply_command(j, groups, command, false, CYPHER_KEY);
+
+    commands_.erase(commands_.begin() + static_cast<std::ptrdiff_t>(applied_), commands_.end());
+    commands_.push_back(std::move(command));
+    if (commands_.size() > COMMAND_LOG_SIZE) commands_.pop_front();
+    applied_ = commands_.size();
+}
+
+
+/*
+ * Reverts the last applied command, nullptr when there is none
+ */
+const PassCurses::Command *
+PassCurses::CommandLog::undo(JSON &j, GroupTree &groups, const int &CYPHER_KEY) {
+    if (applied_ == 0) return nullptr;
+
+    const auto &command = commands_[--applied_];
+    apply_command(j, groups, command, true, CYPHER_KEY);
+
+    return &command;
+}
+
+
+/*
+ * Applies the last reverted command again, nullptr when there is none
+ */
+const PassCurses::Command *
+PassCurses::CommandLog::redo(JSON &j, GroupTree &groups, const int &CYPHER_KEY) {
+    if (applied_ == commands_.size()) return nullptr;
+
+    const auto &command = commands_[applied_++];
+    apply_command(j, groups, command, false, CYPHER_KEY);
+
+    return &command;
+}
+
+
+void
+PassCurses::CommandLog::clear() {
+    commands_.clear();
+    applied_ = 0;
+}
@@ -0,0 +1,125 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <array>
+#include <deque>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "Fields.hpp"
+#include "Groups.hpp"
+#include "Usage.hpp"
+
+
+namespace PassCurses {
+
+    extern const std::size_t COMMAND_LOG_SIZE;
+
+
+    /*
+     * Everything kept for one entry, all encrypted; an empty value means there is no such entry
+     */
+    struct EntryState {
+        std::string                 value;
+        std::array<std::string, 4>  fields;
+        std::vector<std::string>    group;
+        std::vector<std::string>    tags;
+        UsageIndex::Stats           usage{};  // Frecency counters, so a deleted entry comes back where it was
+    };
+
+
+    /*
+     * The part of an entry a command changes
+     */
+    enum class Change { Password, Field, Groups, Entry };
+
+
+    /*
+     * An invertible change to one entry. It holds the entry's state before and after, so
+     * applying or reverting it writes one of the two and never looks at the rest of the vault
+     */
+    struct Command {
+        Change      change;
+        std::string key;
+        Field       field = Field::Username;  // Which field, for Change::Field
+        EntryState  before;
+        EntryState  after;
+    };
+
+
+    /*
+     * Sets a password, adding the entry if it is new
+     */
+    Command
+    password_command(const nlohmann::json &j, const std::string &key, const std::string &value);
+
+
+    /*
+     * Sets one field, an empty value clears it
+     */
+    Command
+    field_command(const std::string &key, Field field, const std::string &value);
+
+
+    Command
+    groups_command(const GroupTree &groups, const std::string &key,
+                   std::vector<std::string> group, std::vector<std::string> tags);
+
+
+    /*
+     * Deletes an entry, keeping its password, fields, group, tags and usage to bring back on revert
+     */
+    Command
+    delete_command(const nlohmann::json &j, const GroupTree &groups, const UsageIndex &usage, const std::string &key);
+
+
+    /*
+     * Writes the command's after state, or its before state when reverting, and saves it
+     */
+    void
+    apply_command(nlohmann::json &j, GroupTree &groups, const Command &command, bool revert, const int &CYPHER_KEY);
+
+
+    /*
+     * What a command does, e.g. "delete 'github'"
+     */
+    std::string
+    describe_command(const Command &command, const int &CYPHER_KEY);
+
+
+    /*
+     * The last COMMAND_LOG_SIZE commands, in memory only, for undo and redo.
+     * Each step applies a single command, so its cost does not depend on the vault's size
+     */
+    class CommandLog {
+    public:
+        /*
+         * Applies a command and records it, dropping whatever was undone before it
+         */
+        void
+        run(nlohmann::json &j, GroupTree &groups, Command command, const int &CYPHER_KEY);
+
+
+        /*
+         * Reverts the last applied command, nullptr when there is none
+         */
+        const Command *
+        undo(nlohmann::json &j, GroupTree &groups, const int &CYPHER_KEY);
+
+
+        /*
+         * Applies the last reverted command again, nullptr when there is none
+         */
+        const Command *
+        redo(nlohmann::json &j, GroupTree &groups, const int &CYPHER_KEY);
+
+
+        /*
+         * Forgets every command, e.g. after switching vaults
+         */
+        void
+        clear();
+
+    private:
+        std::deque<Command> commands_;
+        std::size_t         applied_ = 0;  // Commands before this are applied, the rest were undone
+    };
+}
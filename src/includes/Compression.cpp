@@ -0,0 +1,376 @@
+#include "Compression.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using JSON = nlohmann::json;
+
+const char        PassCurses::COMPRESSED_MAGIC[4] = {'P', 'C', 'Z', '1'};
+const std::size_t PassCurses::BLOCK_TARGET_SIZE   = 16 * 1024;
+
+namespace {
+
+    const std::size_t MIN_MATCH     = 4;
+    const std::size_t LAST_LITERALS = 5;  // Trailing bytes always emitted as literals
+    const std::size_t HASH_BITS     = 12;
+    const std::size_t MAX_OFFSET    = 65535;
+
+
+    inline std::uint32_t
+    read_u32_raw(const char *p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof v);
+        return v;
+    }
+
+
+    inline std::size_t
+    hash_sequence(std::uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+
+    /*
+     * Lengths of 15 or more spill into extra bytes of 255 until the remainder
+     */
+    inline void
+    write_length(std::string &out, std::size_t length) {
+        while (length >= 255) {
+            out.push_back(static_cast<char>(255));
+            length -= 255;
+        }
+        out.push_back(static_cast<char>(length));
+    }
+
+
+    inline bool
+    read_length(const std::string &in, std::size_t &ip, std::size_t &length) {
+        unsigned char byte;
+        do {
+            if (ip >= in.size()) return false;
+            byte = static_cast<unsigned char>(in[ip++]);
+            length += byte;
+        } while (byte == 255);
+
+        return true;
+    }
+
+
+    void
+    emit_sequence(std::string &out, const char *literals, std::size_t literal_length,
+                  std::size_t offset, std::size_t match_length) {
+        const auto lit_nibble   = std::min<std::size_t>(literal_length, 15);
+        const auto match_nibble = match_length ? std::min<std::size_t>(match_length - MIN_MATCH, 15) : 0;
+        out.push_back(static_cast<char>((lit_nibble << 4) | match_nibble));
+        if (lit_nibble == 15) write_length(out, literal_length - 15);
+        out.append(literals, literal_length);
+        if (!match_length) return;
+        out.push_back(static_cast<char>(offset & 0xff));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (match_nibble == 15) write_length(out, match_length - MIN_MATCH - 15);
+    }
+
+
+    inline void
+    put_u16(std::ostream &out, std::uint16_t v) {
+        const char bytes[2] = {static_cast<char>(v & 0xff), static_cast<char>(v >> 8)};
+        out.write(bytes, 2);
+    }
+
+
+    inline void
+    put_u32(std::ostream &out, std::uint32_t v) {
+        char bytes[4];
+        for (auto i = 0; i < 4; i++) bytes[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+        out.write(bytes, 4);
+    }
+
+
+    inline bool
+    get_u16(std::istream &in, std::uint16_t &v) {
+        unsigned char bytes[2];
+        if (!in.read(reinterpret_cast<char *>(bytes), 2)) return false;
+        v = static_cast<std::uint16_t>(bytes[0] | (bytes[1] << 8));
+        return true;
+    }
+
+
+    inline bool
+    get_u32(std::istream &in, std::uint32_t &v) {
+        unsigned char bytes[4];
+        if (!in.read(reinterpret_cast<char *>(bytes), 4)) return false;
+        v = 0;
+        for (auto i = 0; i < 4; i++) v |= static_cast<std::uint32_t>(bytes[i]) << (8 * i);
+        return true;
+    }
+
+
+    /*
+     * Blocks are compressed first and then run through the vault cipher
+     */
+    bool
+    decode_block(const std::string &data, const PassCurses::BlockInfo &block, const int &CYPHER_KEY, JSON &out) {
+        std::string raw;
+        if (!PassCurses::lz_decompress(PassCurses::decrypt(data, CYPHER_KEY), raw, block.raw_length)) return false;
+        out = JSON::parse(raw, nullptr, false);
+
+        return !out.is_discarded() && out.is_object();
+    }
+}
+
+
+/*
+ * Compresses a buffer with the in-tree LZ block codec
+ */
+std::string
+PassCurses::lz_compress(const std::string &input) {
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+
+    const auto length = input.size();
+    const char *base  = input.data();
+    std::vector<std::int64_t> table(std::size_t(1) << HASH_BITS, -1);
+
+    std::size_t ip = 0, anchor = 0;
+    while (length >= LAST_LITERALS + MIN_MATCH && ip + MIN_MATCH + LAST_LITERALS <= length) {
+        const auto sequence = read_u32_raw(base + ip);
+        const auto h        = hash_sequence(sequence);
+        const auto ref      = table[h];
+        table[h] = static_cast<std::int64_t>(ip);
+
+        if (ref < 0 || ip - ref > MAX_OFFSET || read_u32_raw(base + ref) != sequence) {
+            ip++;
+            continue;
+        }
+
+        // Extend the match as far as it goes, leaving the last literals alone
+        auto match_length = MIN_MATCH;
+        const auto limit  = length - LAST_LITERALS;
+        while (ip + match_length < limit && base[ref + match_length] == base[ip + match_length]) match_length++;
+
+        emit_sequence(out, base + anchor, ip - anchor, ip - ref, match_length);
+        ip += match_length;
+        anchor = ip;
+    }
+
+    // The final sequence carries only literals, which is how the decoder knows to stop
+    emit_sequence(out, base + anchor, length - anchor, 0, 0);
+
+    return out;
+}
+
+
+/*
+ * Decompresses an LZ block, returns false if the block is corrupt
+ */
+bool
+PassCurses::lz_decompress(const std::string &input, std::string &output, std::size_t raw_length) {
+    output.clear();
+    // No sequence expands past 255 bytes per input byte, so anything claiming more is corrupt
+    if (raw_length / 255 > input.size()) return false;
+    output.reserve(raw_length);
+
+    std::size_t ip = 0;
+    while (ip < input.size()) {
+        const auto token = static_cast<unsigned char>(input[ip++]);
+
+        std::size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(input, ip, literal_length)) return false;
+        // Lengths are checked before use, a corrupt or wrongly decrypted block can claim billions
+        if (literal_length > input.size() - ip || literal_length > raw_length - output.size()) return false;
+        output.append(input, ip, literal_length);
+        ip += literal_length;
+
+        if (ip == input.size()) break;
+
+        if (ip + 2 > input.size()) return false;
+        const std::size_t offset = static_cast<unsigned char>(input[ip]) |
+                                   (static_cast<unsigned char>(input[ip+1]) << 8);
+        ip += 2;
+
+        std::size_t match_length = token & 0x0f;
+        if (match_length == 15 && !read_length(input, ip, match_length)) return false;
+        match_length += MIN_MATCH;
+
+        if (offset == 0 || offset > output.size() || match_length > raw_length - output.size()) return false;
+        // Copy byte by byte, matches may overlap their own output
+        auto from = output.size() - offset;
+        for (std::size_t i = 0; i < match_length; i++) output.push_back(output[from + i]);
+    }
+
+    return output.size() == raw_length;
+}
+
+
+/*
+ * Checks the stream for the compressed vault magic without consuming it
+ */
+bool
+PassCurses::is_compressed_vault(std::istream &instream) {
+    char magic[4] = {};
+    const auto start = instream.tellg();
+    instream.read(magic, 4);
+    const bool compressed = instream.gcount() == 4 && std::memcmp(magic, COMPRESSED_MAGIC, 4) == 0;
+    instream.clear();
+    instream.seekg(start);
+
+    return compressed;
+}
+
+
+/*
+ * Writes the vault as compressed, encrypted, independently decodable blocks
+ */
+bool
+PassCurses::write_compressed_vault(std::ostream &outstream, const JSON &j, const int &CYPHER_KEY) {
+    std::vector<BlockInfo>   blocks;
+    std::vector<std::string> payloads;
+
+    JSON current = JSON::object();
+    std::size_t current_size = 0;
+    auto flush_block = [&]() {
+        if (current.empty()) return;
+        const std::string raw = current.dump();
+        payloads.push_back(encrypt(lz_compress(raw), CYPHER_KEY));
+        blocks.push_back({static_cast<std::uint32_t>(raw.size()),
+                          static_cast<std::uint32_t>(payloads.back().size()),
+                          static_cast<std::uint32_t>(current.size()),
+                          0,
+                          current.begin().key()});
+        current = JSON::object();
+        current_size = 0;
+    };
+
+    for (auto& [key, value] : j.items()) {
+        current[key] = value;
+        current_size += key.size() + value.dump().size() + 4;
+        if (current_size >= BLOCK_TARGET_SIZE) flush_block();
+    }
+    flush_block();
+
+    outstream.write(COMPRESSED_MAGIC, 4);
+    put_u32(outstream, static_cast<std::uint32_t>(blocks.size()));
+    for (auto &block : blocks) {
+        put_u32(outstream, block.raw_length);
+        put_u32(outstream, block.compressed_length);
+        put_u32(outstream, block.entry_count);
+        put_u16(outstream, static_cast<std::uint16_t>(block.first_key.size()));
+        outstream.write(block.first_key.data(), block.first_key.size());
+    }
+    for (auto &payload : payloads) outstream.write(payload.data(), payload.size());
+
+    return static_cast<bool>(outstream);
+}
+
+
+/*
+ * Reads the block index of a compressed vault
+ */
+bool
+PassCurses::read_block_index(std::istream &instream, std::vector<BlockInfo> &blocks) {
+    char magic[4];
+    if (!instream.read(magic, 4) || std::memcmp(magic, COMPRESSED_MAGIC, 4) != 0) return false;
+
+    std::uint32_t block_count;
+    if (!get_u32(instream, block_count)) return false;
+
+    blocks.clear();
+    blocks.reserve(block_count);
+    for (std::uint32_t i = 0; i < block_count; i++) {
+        BlockInfo block {};
+        std::uint16_t key_length;
+        if (!get_u32(instream, block.raw_length) ||
+            !get_u32(instream, block.compressed_length) ||
+            !get_u32(instream, block.entry_count) ||
+            !get_u16(instream, key_length)) return false;
+        block.first_key.resize(key_length);
+        if (!instream.read(block.first_key.data(), key_length)) return false;
+        blocks.push_back(std::move(block));
+    }
+
+    // Block data follows the index back to back
+    std::uint64_t offset = static_cast<std::uint64_t>(instream.tellg());
+    for (auto &block : blocks) {
+        block.offset = offset;
+        offset += block.compressed_length;
+    }
+
+    return true;
+}
+
+
+/*
+ * Reads and decodes a single block of a compressed vault
+ */
+bool
+PassCurses::read_vault_block(std::istream &instream, const BlockInfo &block, const int &CYPHER_KEY, JSON &out) {
+    std::string data(block.compressed_length, '\0');
+    instream.clear();
+    instream.seekg(block.offset);
+    if (!instream.read(data.data(), data.size())) return false;
+
+    return decode_block(data, block, CYPHER_KEY, out);
+}
+
+
+/*
+ * Reads a whole compressed vault, decoding blocks in parallel
+ */
+bool
+PassCurses::read_compressed_vault(std::istream &instream, const int &CYPHER_KEY, JSON &j) {
+    std::vector<BlockInfo> blocks;
+    if (!read_block_index(instream, blocks)) return false;
+
+    // One sequential read for all block data, then decode concurrently
+    std::vector<std::string> data(blocks.size());
+    for (std::size_t i = 0; i < blocks.size(); i++) {
+        data[i].resize(blocks[i].compressed_length);
+        if (!instream.read(data[i].data(), data[i].size())) return false;
+    }
+
+    std::vector<JSON> decoded(blocks.size());
+    std::vector<char> ok(blocks.size(), 0);
+    const auto thread_count = std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(), blocks.size()));
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < thread_count; t++) {
+        workers.emplace_back([&, t]() {
+            for (auto i = t; i < blocks.size(); i += thread_count) {
+                ok[i] = decode_block(data[i], blocks[i], CYPHER_KEY, decoded[i]);
+            }
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) return false;
+
+    j = JSON::object();
+    for (auto &block : decoded) j.update(block);
+
+    return true;
+}
+
+
+/*
+ * Finds a single entry by encrypted key, decoding only the block holding it
+ */
+bool
+PassCurses::lookup_compressed_entry(std::istream &instream, const std::string &key, const int &CYPHER_KEY, std::string &value) {
+    std::vector<BlockInfo> blocks;
+    if (!read_block_index(instream, blocks) || blocks.empty()) return false;
+
+    // Blocks are written in key order, so the candidate is the last one starting at or before the key
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), key,
+                               [](const std::string &k, const BlockInfo &b) { return k < b.first_key; });
+    if (it == blocks.begin()) return false;
+    --it;
+
+    JSON block;
+    if (!read_vault_block(instream, *it, CYPHER_KEY, block)) return false;
+    auto entry = block.find(key);
+    if (entry == block.end()) return false;
+    value = entry->get<std::string>();
+
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+
+namespace PassCurses {
+
+    /*
+     * Magic bytes at the start of a compressed vault file
+     */
+    extern const char COMPRESSED_MAGIC[4];
+
+
+    /*
+     * Uncompressed size a block is filled up to before a new one is started
+     */
+    extern const std::size_t BLOCK_TARGET_SIZE;
+
+
+    /*
+     * One entry in the block index of a compressed vault; blocks are
+     * independently decodable so any one can be read on its own
+     */
+    struct BlockInfo {
+        std::uint32_t raw_length;
+        std::uint32_t compressed_length;
+        std::uint32_t entry_count;
+        std::uint64_t offset;     // Offset of the block data from the start of the file
+        std::string   first_key;  // Encrypted key of the first entry, for random access
+    };
+
+
+    /*
+     * Compresses a buffer with the in-tree LZ block codec
+     */
+    std::string
+    lz_compress(const std::string &input);
+
+
+    /*
+     * Decompresses an LZ block, returns false if the block is corrupt
+     */
+    bool
+    lz_decompress(const std::string &input, std::string &output, std::size_t raw_length);
+
+
+    /*
+     * Checks the stream for the compressed vault magic without consuming it
+     */
+    bool
+    is_compressed_vault(std::istream &instream);
+
+
+    /*
+     * Writes the vault as compressed, encrypted, independently decodable blocks
+     */
+    bool
+    write_compressed_vault(std::ostream &outstream, const nlohmann::json &j, const int &CYPHER_KEY);
+
+
+    /*
+     * Reads the block index of a compressed vault
+     */
+    bool
+    read_block_index(std::istream &instream, std::vector<BlockInfo> &blocks);
+
+
+    /*
+     * Reads and decodes a single block of a compressed vault
+     */
+    bool
+    read_vault_block(std::istream &instream, const BlockInfo &block, const int &CYPHER_KEY, nlohmann::json &out);
+
+
+    /*
+     * Reads a whole compressed vault, decoding blocks in parallel
+     */
+    bool
+    read_compressed_vault(std::istream &instream, const int &CYPHER_KEY, nlohmann::json &j);
+
+
+    /*
+     * Finds a single entry by encrypted key, decoding only the block holding it
+     */
+    bool
+    lookup_compressed_entry(std::istream &instream, const std::string &key, const int &CYPHER_KEY, std::string &value);
+}
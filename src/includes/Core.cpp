@@ -0,0 +1,320 @@
+#include "Core.hpp"
+
+using namespace PassCurses;
+
+using JSON = nlohmann::json;
+
+const std::string PassCurses::HOME_DIRECTORY = PassCurses::get_home_directory();
+
+bool PassCurses::COMPRESSED_STORAGE = false;  // Set when the vault was loaded from, or should be saved to, the compressed format
+
+std::atomic<std::uint64_t> PassCurses::VAULT_WRITES{0};  // Bumped before every vault or journal write, so background readers can tell
+
+const std::uintmax_t PassCurses::JOURNAL_COMPACT_SIZE = 1 << 20;  // Past this the whole vault is written once and the journal starts over
+
+PassCurses::FieldStore PassCurses::FIELD_STORE;
+
+
+/*
+ * Encrypts messages with XOR encryption
+ */
+std::string
+PassCurses::encrypt(std::string message, const int &CYPHER_KEY) {
+    for (auto &ch : message ) ch ^= CYPHER_KEY;
+
+    return message;
+}
+
+
+/*
+ * Decrypts XOR-encrypted messages
+ */
+std::string
+PassCurses::decrypt(std::string message, const int &CYPHER_KEY) { return encrypt(std::move(message), CYPHER_KEY); }
+
+
+std::string
+PassCurses::get_home_directory() {
+    struct passwd *pwd = getpwuid(getuid());
+
+    const char* home_directory = pwd->pw_dir;
+
+    return std::string(home_directory);
+}
+
+
+/*
+ * Reads the master password from the vault's passrc
+ */
+std::string
+PassCurses::read_master_password(const int &CYPHER_KEY) {
+    std::ifstream instream(passrc_path());
+    if (instream.fail()) {
+        std::cerr << "CANNOT OPEN PASSRC" << std::endl;
+    }
+
+    std::string master_password;
+    std::getline(instream, master_password);
+    instream.close();
+
+    const std::string final_master_password = decrypt(master_password, CYPHER_KEY);
+
+    return final_master_password;
+}
+
+
+namespace {
+
+    /*
+     * Sets or erases an entry and appends the change to the journal
+     */
+    void
+    save_entry(JSON &j, const std::string &key, const std::string &value, const int &CYPHER_KEY) {
+        JSON change = JSON::array({key});
+        if (value.empty()) j.erase(key);
+        else {
+            j[key] = value;
+            change.push_back(value);
+        }
+
+        VAULT_WRITES++;
+        std::ofstream outstream(journal_file_path(), std::ios::binary | std::ios::app);
+        if (!outstream.is_open()) {
+            std::cerr << "CAN'T WRITE TO JOURNAL!" << std::endl;
+            return;
+        }
+        outstream << change.dump() << '\n';
+        outstream.close();
+
+        // One full write now and then keeps the journal, and so the next load, short
+        if (outstream.fail() || fs::file_size(journal_file_path()) > JOURNAL_COMPACT_SIZE) write_to_file(j, CYPHER_KEY);
+    }
+
+
+    /*
+     * Applies the journal on top of a freshly read vault, one [key, value] or [key] line per change.
+     * A torn last line, from a crash mid-append, ends the replay
+     */
+    void
+    replay_journal(JSON &j) {
+        std::ifstream instream(journal_file_path(), std::ios::binary);
+        std::string line;
+        while (std::getline(instream, line)) {
+            const auto change = JSON::parse(line, nullptr, false);
+            if (!change.is_array() || change.empty() || change.size() > 2 || !change[0].is_string()) break;
+            if (change.size() == 1) j.erase(change[0].get<std::string>());
+            else if (change[1].is_string()) j[change[0].get<std::string>()] = change[1];
+            else break;
+        }
+    }
+}
+
+
+/*
+ * Reads a password file in either the plain or the compressed format, then replays the
+ * journal of changes saved since it was last written. False if it is corrupt
+ */
+bool
+PassCurses::load_vault(std::istream &instream, const int &CYPHER_KEY, JSON &j) {
+    if (is_compressed_vault(instream)) {
+        if (!read_compressed_vault(instream, CYPHER_KEY, j)) return false;
+        COMPRESSED_STORAGE = true;
+    } else {
+        j = JSON::parse(instream, nullptr, false);
+        if (j.is_discarded()) return false;
+    }
+
+    if (j.is_object()) replay_journal(j);
+
+    return true;
+}
+
+
+/*
+ * Finds one entry's encrypted value on disk without loading a compressed vault: the
+ * journal's last change to the key wins, otherwise only the block holding it is decoded.
+ * False if there is no such entry, or the vault is not compressed
+ */
+bool
+PassCurses::lookup_entry(const std::string &key, const int &CYPHER_KEY, std::string &value) {
+    std::ifstream journal(journal_file_path(), std::ios::binary);
+    const std::string needle = JSON(key).dump();
+    auto journaled = false, deleted = false;
+    std::string line;
+    while (std::getline(journal, line)) {
+        // Cheap reject before parsing, the key appears verbatim in its own changes
+        if (line.find(needle) == std::string::npos) continue;
+        const auto change = JSON::parse(line, nullptr, false);
+        if (!change.is_array() || change.empty() || change.size() > 2 || !change[0].is_string()) break;
+        if (change[0].get_ref<const std::string &>() != key) continue;
+        if (change.size() == 2 && !change[1].is_string()) break;
+        journaled = true;
+        deleted   = change.size() == 1;
+        if (!deleted) value = change[1].get<std::string>();
+    }
+    journal.close();
+    if (journaled) return !deleted;
+
+    std::ifstream instream(vault_file_path(), std::ios::binary);
+
+    return is_compressed_vault(instream) && lookup_compressed_entry(instream, key, CYPHER_KEY, value);
+}
+
+
+/*
+ * Writes edited JSON to file, which makes the journal redundant
+ */
+void
+PassCurses::write_to_file(JSON &j, const int &CYPHER_KEY) {
+    VAULT_WRITES++;
+    std::ofstream outstream(vault_file_path(), std::ios::binary);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE TO FILE!" << std::endl;
+        return;
+    }
+
+    if (COMPRESSED_STORAGE) write_compressed_vault(outstream, j, CYPHER_KEY);
+    else outstream << std::setw(4) << j << std::endl;
+    outstream.close();
+
+    // Replaying the journal over the new file changes nothing, so a crash before this is harmless
+    std::error_code ec;
+    if (!outstream.fail()) fs::remove(journal_file_path(), ec);
+}
+
+
+/*
+ * Sets an entry's encrypted value, an empty value deletes it. The old value goes to the
+ * history and only this entry is saved, by appending it to the journal
+ */
+void
+PassCurses::set_entry(JSON &j, const std::string &key, const std::string &value, const int &CYPHER_KEY) {
+    if (j.contains(key)) record_history(key, j[key].get<std::string>(), value);
+    else if (value.empty()) return;
+
+    save_entry(j, key, value, CYPHER_KEY);
+}
+
+
+/*
+ * Puts back the value an entry had before set_entry changed it, an empty value for an entry that
+ * set_entry added. The history record of that change is taken back rather than a new one added
+ */
+void
+PassCurses::revert_entry(JSON &j, const std::string &key, const std::string &value, const int &CYPHER_KEY) {
+    const auto current = j.contains(key) ? j[key].get<std::string>() : std::string();
+    if (current.empty() && value.empty()) return;
+
+    // Something else was recorded since, so record this one too and keep the deltas chained
+    if (!value.empty() && !take_back_history(key, value, current) && !current.empty()) {
+        record_history(key, current, value);
+    }
+
+    save_entry(j, key, value, CYPHER_KEY);
+}
+
+
+/*
+ * Folds the journals into the vault and field files, if there is anything in them
+ */
+void
+PassCurses::compact_vault(JSON &j, const int &CYPHER_KEY) {
+    std::error_code ec;
+    if (fs::file_size(journal_file_path(), ec) > 0 && !ec) write_to_file(j, CYPHER_KEY);
+    FIELD_STORE.compact();
+}
+
+
+/*
+ * Random password of letters and digits
+ */
+std::string
+PassCurses::random_password(std::size_t length) {
+    static const std::string ALPHABET = "0123456789"
+                                        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                        "abcdefghijklmnopqrstuvwxyz";
+
+    // RNG logic
+    std::random_device rd;
+    std::mt19937 rng(rd());
+    std::uniform_int_distribution<std::size_t> uni(0, ALPHABET.size() - 1);
+
+    std::string passw(length, '\0');
+    for (auto &ch : passw) ch = ALPHABET[uni(rng)];
+
+    return passw;
+}
+
+
+/*
+ * Adds or overwrites a password, keeping the old value in the history, and saves it
+ */
+std::string
+PassCurses::store_password(JSON &j, const std::string &name, const std::string &password, const int &CYPHER_KEY) {
+    std::string final_key = encrypt(name, CYPHER_KEY);
+    set_entry(j, final_key, encrypt(password, CYPHER_KEY), CYPHER_KEY); // setting the new/overridden value
+
+    return final_key;
+}
+
+
+/*
+ * Removes an entry, by encrypted key, together with its fields, and saves the change
+ */
+bool
+PassCurses::delete_entry(JSON &j, const std::string &key, const int &CYPHER_KEY) {
+    if (!j.contains(key)) return false;
+
+    set_entry(j, key, "", CYPHER_KEY);
+    FIELD_STORE.erase(key);
+
+    return true;
+}
+
+
+/*
+ * Encrypted key matching a search: an exact key wins, otherwise the best-scoring key containing the text
+ */
+std::string
+PassCurses::find_entry(const JSON &j, const std::string &text, const int &CYPHER_KEY, const UsageIndex &usage) {
+    if (text.empty()) return "";
+    if (j.contains(encrypt(text, CYPHER_KEY))) return encrypt(text, CYPHER_KEY);
+
+    std::string found;
+    for (auto& [key, value] : j.items()) {
+        if (decrypt(key, CYPHER_KEY).find(text) == std::string::npos) continue;
+        if (found.empty() || usage.score(key) > usage.score(found)) found = key;
+    }
+
+    return found;
+}
+
+
+/*
+ * Decrypted value of one field of an entry, empty if it has none
+ */
+std::string
+PassCurses::read_field(Field field, const std::string &key, const int &CYPHER_KEY) {
+    std::string value;
+    if (!FIELD_STORE.column(field).get(key, value)) return "";
+
+    return decrypt(value, CYPHER_KEY);
+}
+
+
+std::string
+PassCurses::usage_file_path() {
+    return VAULT_DIRECTORY + "/usage.dat";
+}
+
+
+std::string
+PassCurses::groups_file_path() {
+    return VAULT_DIRECTORY + "/groups.json";
+}
+
+
+std::string
+PassCurses::journal_file_path() {
+    return VAULT_DIRECTORY + "/journal.log";
+}
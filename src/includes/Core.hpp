@@ -0,0 +1,163 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+#include <sys/types.h>
+#include <pwd.h>
+#include "json.hpp"
+#include "Compression.hpp"
+#include "History.hpp"
+#include "Usage.hpp"
+#include "Audit.hpp"
+#include "Breach.hpp"
+#include "Vaults.hpp"
+#include "Groups.hpp"
+#include "Fields.hpp"
+#include "WarmCache.hpp"
+#include "Commands.hpp"
+
+namespace fs = std::filesystem;
+
+
+/*
+ * Everything here works on the vault without a terminal, it's what libpasscurses is built from
+ */
+namespace PassCurses {
+
+    extern const std::string HOME_DIRECTORY;
+    extern bool COMPRESSED_STORAGE;
+    extern const std::uintmax_t JOURNAL_COMPACT_SIZE;
+    extern std::atomic<std::uint64_t> VAULT_WRITES;
+    extern FieldStore FIELD_STORE;
+
+
+    /*
+     * Encrypts messages with XOR encryption
+     */
+    std::string
+    encrypt(std::string message, const int &CYPHER_KEY);
+
+
+    /*
+     * Decrypts XOR-encrypted messages
+     */
+    std::string
+    decrypt(std::string message, const int &CYPHER_KEY);
+
+
+    std::string
+    get_home_directory();
+
+
+    /*
+     * Reads the master password from the vault's passrc
+     */
+    std::string
+    read_master_password(const int &CYPHER_KEY);
+
+
+    /*
+     * Reads a password file in either the plain or the compressed format, then replays the
+     * journal of changes saved since it was last written. False if it is corrupt
+     */
+    bool
+    load_vault(std::istream &instream, const int &CYPHER_KEY, nlohmann::json &j);
+
+
+    /*
+     * Finds one entry's encrypted value on disk without loading a compressed vault: the
+     * journal's last change to the key wins, otherwise only the block holding it is decoded.
+     * False if there is no such entry, or the vault is not compressed
+     */
+    bool
+    lookup_entry(const std::string &key, const int &CYPHER_KEY, std::string &value);
+
+
+    /*
+     * Writes edited nlohmann::json to file, which makes the journal redundant
+     */
+    void
+    write_to_file(nlohmann::json &j, const int &CYPHER_KEY);
+
+
+    /*
+     * Sets an entry's encrypted value, an empty value deletes it. The old value goes to the
+     * history and only this entry is saved, by appending it to the journal
+     */
+    void
+    set_entry(nlohmann::json &j, const std::string &key, const std::string &value, const int &CYPHER_KEY);
+
+
+    /*
+     * Puts back the value an entry had before set_entry changed it, an empty value for an entry that
+     * set_entry added. The history record of that change is taken back rather than a new one added
+     */
+    void
+    revert_entry(nlohmann::json &j, const std::string &key, const std::string &value, const int &CYPHER_KEY);
+
+
+    /*
+     * Folds the journals into the vault and field files, if there is anything in them
+     */
+    void
+    compact_vault(nlohmann::json &j, const int &CYPHER_KEY);
+
+
+    /*
+     * Random password of letters and digits
+     */
+    std::string
+    random_password(std::size_t length);
+
+
+    /*
+     * Adds or overwrites a password, keeping the old value in the history, and saves it.
+     * Returns the encrypted key.
+     */
+    std::string
+    store_password(nlohmann::json &j, const std::string &name, const std::string &password, const int &CYPHER_KEY);
+
+
+    /*
+     * Removes an entry, by encrypted key, together with its fields, and saves the change
+     */
+    bool
+    delete_entry(nlohmann::json &j, const std::string &key, const int &CYPHER_KEY);
+
+
+    /*
+     * Encrypted key matching a search: an exact key wins, otherwise the best-scoring key containing the text
+     */
+    std::string
+    find_entry(const nlohmann::json &j, const std::string &text, const int &CYPHER_KEY, const UsageIndex &usage);
+
+
+    /*
+     * Decrypted value of one field of an entry, empty if it has none
+     */
+    std::string
+    read_field(Field field, const std::string &key, const int &CYPHER_KEY);
+
+
+    /*
+     * Path of the encrypted usage statistics
+     */
+    std::string
+    usage_file_path();
+
+
+    std::string
+    groups_file_path();
+
+
+    /*
+     * Path of the changes saved since the vault file was last written
+     */
+    std::string
+    journal_file_path();
+}
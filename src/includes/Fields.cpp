@@ -0,0 +1,305 @@
+#include "Fields.hpp"
+#include "Core.hpp"
+#include <cstring>
+
+using JSON = nlohmann::json;
+
+const int PassCurses::TOTP_PERIOD = 30;
+const int PassCurses::TOTP_DIGITS = 6;
+
+const std::array<PassCurses::Field, 4> PassCurses::ALL_FIELDS = {
+    PassCurses::Field::Username, PassCurses::Field::Url, PassCurses::Field::Notes, PassCurses::Field::TotpSeed
+};
+
+namespace {
+
+    const char FIELD_MAGIC[4] = {'P', 'C', 'F', '1'};
+
+
+    inline void
+    put_u32(std::ostream &out, std::uint32_t v) {
+        out.write(reinterpret_cast<const char *>(&v), sizeof v);
+    }
+
+
+    inline bool
+    get_u32(std::istream &in, std::uint32_t &v) {
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&v), sizeof v));
+    }
+}
+
+
+const char *
+PassCurses::field_name(Field field) {
+    switch (field) {
+        case Field::Username: return "username";
+        case Field::Url:      return "url";
+        case Field::Notes:    return "notes";
+        case Field::TotpSeed: return "totp";
+    }
+
+    return "";
+}
+
+
+std::string
+PassCurses::FieldColumn::path() const {
+    return VAULT_DIRECTORY + "/fields/" + field_name(field_) + ".col";
+}
+
+
+std::string
+PassCurses::FieldColumn::journal_path() const {
+    return path() + ".log";
+}
+
+
+/*
+ * Encrypted value of the field for an entry, false if it has none
+ */
+bool
+PassCurses::FieldColumn::get(const std::string &key, std::string &value) {
+    if (!loaded_) load_index();
+
+    auto change = changes_.find(key);
+    if (change != changes_.end()) {
+        value = change->second;
+        return !value.empty();
+    }
+
+    auto it = index_.find(key);
+    if (it == index_.end()) return false;
+
+    std::ifstream instream(path(), std::ios::binary);
+    value.resize(it->second.length);
+    instream.seekg(it->second.offset);
+
+    return static_cast<bool>(instream.read(value.data(), value.size()));
+}
+
+
+/*
+ * Sets an entry's encrypted value, an empty value removes it. Only the change is written
+ */
+void
+PassCurses::FieldColumn::set(const std::string &key, const std::string &value) {
+    std::string current;
+    get(key, current);
+    if (current == value) return;
+
+    // [key, value] or [key], the same lines as the vault journal
+    JSON change = JSON::array({key});
+    if (!value.empty()) change.push_back(value);
+
+    fs::create_directories(VAULT_DIRECTORY + "/fields");
+    std::ofstream outstream(journal_path(), std::ios::binary | std::ios::app);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE TO FIELD FILE!" << std::endl;
+        return;
+    }
+    outstream << change.dump() << '\n';
+    outstream.close();
+    changes_[key] = value;
+
+    if (fs::file_size(journal_path()) > JOURNAL_COMPACT_SIZE) compact();
+}
+
+
+/*
+ * Folds the journal into the column file, if there is anything in it
+ */
+void
+PassCurses::FieldColumn::compact() {
+    if (!loaded_) load_index();
+    if (changes_.empty()) return;
+
+    // Only this column is rewritten; the other fields of every entry stay where they are
+    std::unordered_map<std::string, std::string> values;
+    std::ifstream instream(path(), std::ios::binary);
+    for (auto& [key, span] : index_) {
+        if (changes_.count(key)) continue;
+        auto &stored = values[key];
+        stored.resize(span.length);
+        instream.seekg(span.offset);
+        instream.read(stored.data(), stored.size());
+    }
+    instream.close();
+    for (auto& [key, value] : changes_) {
+        if (!value.empty()) values[key] = value;
+    }
+
+    std::ofstream outstream(path() + ".tmp", std::ios::binary);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE TO FIELD FILE!" << std::endl;
+        return;
+    }
+    outstream.write(FIELD_MAGIC, 4);
+    put_u32(outstream, static_cast<std::uint32_t>(values.size()));
+    for (auto& [key, stored] : values) {
+        put_u32(outstream, static_cast<std::uint32_t>(key.size()));
+        outstream.write(key.data(), key.size());
+        put_u32(outstream, static_cast<std::uint32_t>(stored.size()));
+        outstream.write(stored.data(), stored.size());
+    }
+    outstream.close();
+    if (outstream.fail()) return;
+    fs::rename(path() + ".tmp", path());
+
+    // The new file holds every change, so a crash before this only replays them again
+    std::error_code ec;
+    fs::remove(journal_path(), ec);
+    reset();
+}
+
+
+/*
+ * Forgets the index, e.g. after switching vaults
+ */
+void
+PassCurses::FieldColumn::reset() {
+    loaded_ = false;
+    index_.clear();
+    changes_.clear();
+}
+
+
+/*
+ * Reads keys and value positions only, seeking past every value, then the journaled changes
+ */
+void
+PassCurses::FieldColumn::load_index() {
+    loaded_ = true;
+    index_.clear();
+    changes_.clear();
+
+    std::ifstream instream(path(), std::ios::binary);
+    char magic[4];
+    std::uint32_t count;
+    if (instream.read(magic, 4) && std::memcmp(magic, FIELD_MAGIC, 4) == 0 && get_u32(instream, count)) {
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::uint32_t key_length, value_length;
+            if (!get_u32(instream, key_length)) break;
+            std::string key(key_length, '\0');
+            if (!instream.read(key.data(), key_length) || !get_u32(instream, value_length)) break;
+            const auto offset = static_cast<std::uint64_t>(instream.tellg());
+            index_[key] = {offset, value_length};
+            instream.seekg(value_length, std::ios::cur);
+        }
+    }
+    instream.close();
+
+    // A torn last line, from a crash mid-append, ends the replay
+    std::ifstream journal(journal_path(), std::ios::binary);
+    std::string line;
+    while (std::getline(journal, line)) {
+        const auto change = JSON::parse(line, nullptr, false);
+        if (!change.is_array() || change.empty() || change.size() > 2 || !change[0].is_string()) break;
+        if (change.size() == 2 && !change[1].is_string()) break;
+        changes_[change[0].get<std::string>()] = change.size() == 2 ? change[1].get<std::string>() : "";
+    }
+}
+
+
+PassCurses::FieldStore::FieldStore()
+    : columns_{FieldColumn(Field::Username), FieldColumn(Field::Url),
+               FieldColumn(Field::Notes), FieldColumn(Field::TotpSeed)} {}
+
+
+/*
+ * Removes a deleted entry from every column
+ */
+void
+PassCurses::FieldStore::erase(const std::string &key) {
+    for (auto &column : columns_) column.set(key, "");
+}
+
+
+/*
+ * Folds every column's journal into its file
+ */
+void
+PassCurses::FieldStore::compact() {
+    for (auto &column : columns_) column.compact();
+}
+
+
+void
+PassCurses::FieldStore::reset() {
+    for (auto &column : columns_) column.reset();
+}
+
+
+/*
+ * Decodes a base32 TOTP seed, ignoring spaces, dashes and padding
+ */
+bool
+PassCurses::base32_decode(const std::string &text, std::string &out) {
+    out.clear();
+    std::uint32_t buffer = 0;
+    auto bits = 0;
+    for (auto ch : text) {
+        if (ch == ' ' || ch == '-' || ch == '=') continue;
+        ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+
+        int value;
+        if (ch >= 'A' && ch <= 'Z') value = ch - 'A';
+        else if (ch >= '2' && ch <= '7') value = ch - '2' + 26;
+        else return false;
+
+        buffer = (buffer << 5) | static_cast<std::uint32_t>(value);
+        bits += 5;
+        if (bits >= 8) {
+            out.push_back(static_cast<char>((buffer >> (bits - 8)) & 0xff));
+            bits -= 8;
+        }
+    }
+
+    return !out.empty();
+}
+
+
+/*
+ * HMAC-SHA1 of a message under a key
+ */
+std::array<std::uint8_t, 20>
+PassCurses::hmac_sha1(const std::string &key, const std::string &message) {
+    std::string block_key = key.size() > 64 ? std::string(reinterpret_cast<const char *>(sha1(key).data()), 20) : key;
+    block_key.resize(64, '\0');
+
+    std::string inner(64, '\0'), outer(64, '\0');
+    for (auto i = 0; i < 64; i++) {
+        inner[i] = static_cast<char>(block_key[i] ^ 0x36);
+        outer[i] = static_cast<char>(block_key[i] ^ 0x5c);
+    }
+    const auto inner_digest = sha1(inner + message);
+
+    return sha1(outer + std::string(reinterpret_cast<const char *>(inner_digest.data()), inner_digest.size()));
+}
+
+
+/*
+ * RFC 6238 time-based one-time password for a base32 seed, empty if the seed is invalid
+ */
+std::string
+PassCurses::totp_code(const std::string &base32_seed, std::time_t now) {
+    std::string secret;
+    if (!base32_decode(base32_seed, secret)) return "";
+
+    auto counter = static_cast<std::uint64_t>(now) / TOTP_PERIOD;
+    std::string message(8, '\0');
+    for (auto i = 7; i >= 0; i--) {
+        message[i] = static_cast<char>(counter & 0xff);
+        counter >>= 8;
+    }
+
+    const auto digest = hmac_sha1(secret, message);
+    const auto offset = digest[19] & 0x0f;
+    const std::uint32_t binary = ((digest[offset] & 0x7f) << 24) | (digest[offset+1] << 16) |
+                                 (digest[offset+2] << 8) | digest[offset+3];
+
+    std::uint32_t modulus = 1;
+    for (auto i = 0; i < TOTP_DIGITS; i++) modulus *= 10;
+    auto code = std::to_string(binary % modulus);
+
+    return std::string(TOTP_DIGITS - code.size(), '0') + code;
+}
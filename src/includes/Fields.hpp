@@ -0,0 +1,133 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+
+
+namespace PassCurses {
+
+    extern const int TOTP_PERIOD;
+    extern const int TOTP_DIGITS;
+
+
+    /*
+     * Fields an entry may carry besides its key and password
+     */
+    enum class Field { Username, Url, Notes, TotpSeed };
+
+    extern const std::array<Field, 4> ALL_FIELDS;
+
+
+    const char *
+    field_name(Field field);
+
+
+    /*
+     * One field of every entry, stored in its own file so that reading one
+     * field never touches the others. Values stay encrypted on disk and in memory;
+     * the index of where each value sits is read on the first lookup, values
+     * themselves only when asked for. Changes are appended to a journal beside the
+     * file and folded into it by compact, like the vault's own journal.
+     */
+    class FieldColumn {
+    public:
+        explicit FieldColumn(Field field) : field_(field) {}
+
+        /*
+         * Encrypted value of the field for an entry, false if it has none
+         */
+        bool
+        get(const std::string &key, std::string &value);
+
+        /*
+         * Sets an entry's encrypted value, an empty value removes it. Only the change is written
+         */
+        void
+        set(const std::string &key, const std::string &value);
+
+        /*
+         * Folds the journal into the column file, if there is anything in it
+         */
+        void
+        compact();
+
+        /*
+         * Forgets the index, e.g. after switching vaults
+         */
+        void
+        reset();
+
+        std::string
+        path() const;
+
+        std::string
+        journal_path() const;
+
+    private:
+        struct Span {
+            std::uint64_t offset;
+            std::uint32_t length;
+        };
+
+        void
+        load_index();
+
+        Field                                         field_;
+        bool                                          loaded_ = false;
+        std::unordered_map<std::string, Span>         index_;    // Values in the column file
+        std::unordered_map<std::string, std::string>  changes_;  // Journaled since, empty when removed
+    };
+
+
+    /*
+     * All field columns of the open vault
+     */
+    class FieldStore {
+    public:
+        FieldStore();
+
+        FieldColumn &
+        column(Field field) { return columns_[static_cast<std::size_t>(field)]; }
+
+        /*
+         * Removes a deleted entry from every column
+         */
+        void
+        erase(const std::string &key);
+
+        /*
+         * Folds every column's journal into its file
+         */
+        void
+        compact();
+
+        void
+        reset();
+
+    private:
+        std::array<FieldColumn, 4> columns_;
+    };
+
+
+    /*
+     * Decodes a base32 TOTP seed, ignoring spaces, dashes and padding
+     */
+    bool
+    base32_decode(const std::string &text, std::string &out);
+
+
+    /*
+     * HMAC-SHA1 of a message under a key
+     */
+    std::array<std::uint8_t, 20>
+    hmac_sha1(const std::string &key, const std::string &message);
+
+
+    /*
+     * RFC 6238 time-based one-time password for a base32 seed, empty if the seed is invalid
+     */
+    std::string
+    totp_code(const std::string &base32_seed, std::time_t now);
+}
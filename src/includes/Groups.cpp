@@ -0,0 +1,492 @@
+#include "Groups.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <set>
+
+using JSON = nlohmann::json;
+
+namespace {
+
+    const std::vector<std::string> NO_STRINGS;
+
+
+    inline bool
+    insert_sorted(std::vector<std::string> &keys, const std::string &key) {
+        auto slot = std::lower_bound(keys.begin(), keys.end(), key);
+        if (slot != keys.end() && *slot == key) return false;
+        keys.insert(slot, key);
+
+        return true;
+    }
+
+
+    inline bool
+    erase_sorted(std::vector<std::string> &keys, const std::string &key) {
+        auto slot = std::lower_bound(keys.begin(), keys.end(), key);
+        if (slot == keys.end() || *slot != key) return false;
+        keys.erase(slot);
+
+        return true;
+    }
+
+
+    /*
+     * Rows a group takes inside its parent: its header, and its contents while it is open
+     */
+    inline std::size_t
+    footprint(const PassCurses::GroupTree::Group *group) {
+        return 1 + (group->expanded ? group->rows : 0);
+    }
+
+
+    /*
+     * Adds delta rows to a group's contents, and to every enclosing group the change shows in
+     */
+    void
+    grow(PassCurses::GroupTree::Group *group, std::ptrdiff_t delta) {
+        // A closed group hides the change from everything above it
+        for (; group; group = group->expanded ? group->parent : nullptr) {
+            group->rows += static_cast<std::size_t>(delta);
+        }
+    }
+
+
+    /*
+     * Counts the rows of a group and everything in it from scratch
+     */
+    void
+    count_rows(PassCurses::GroupTree::Group *group) {
+        group->rows = group->entries.size();
+        for (auto& [name, child] : group->children) {
+            count_rows(child.get());
+            group->rows += footprint(child.get());
+        }
+    }
+
+
+    /*
+     * Changes saved since the groups file was last written
+     */
+    inline std::string
+    journal_path(const std::string &path) {
+        return path + ".log";
+    }
+
+
+    /*
+     * Encrypted path components of a group, from the top down
+     */
+    std::vector<std::string>
+    path_of(const PassCurses::GroupTree::Group *group) {
+        std::vector<std::string> path;
+        for (; group && group->parent; group = group->parent) path.push_back(group->name);
+        std::reverse(path.begin(), path.end());
+
+        return path;
+    }
+}
+
+
+/*
+ * Reads group paths and tags, then the journal of changes saved since; a missing file
+ * means everything is ungrouped
+ */
+void
+PassCurses::GroupTree::load(const std::string &path) {
+    paths_.clear();
+    tags_.clear();
+    tag_index_.clear();
+
+    std::ifstream instream(path);
+    auto groups = JSON::parse(instream, nullptr, false);
+    instream.close();
+    if (!groups.is_discarded() && groups.is_object()) {
+        for (auto& [key, value] : groups.items()) {
+            if (value.contains("g")) paths_[key] = value["g"].get<std::vector<std::string>>();
+            if (value.contains("t")) set_tags(key, value["t"].get<std::vector<std::string>>());
+        }
+    }
+
+    // One [key, group path, tags] line per change. A torn last line, from a crash mid-append, ends the replay
+    std::ifstream journal(journal_path(path));
+    std::string line;
+    while (std::getline(journal, line)) {
+        const auto change = JSON::parse(line, nullptr, false);
+        if (!change.is_array() || change.size() != 3 || !change[0].is_string() ||
+            !change[1].is_array() || !change[2].is_array()) break;
+        const auto key = change[0].get<std::string>();
+        auto group = change[1].get<std::vector<std::string>>();
+        if (group.empty()) paths_.erase(key);
+        else paths_[key] = std::move(group);
+        set_tags(key, change[2].get<std::vector<std::string>>());
+    }
+}
+
+
+/*
+ * Writes every group path and tag, which makes the journal redundant
+ */
+void
+PassCurses::GroupTree::save(const std::string &path) const {
+    JSON groups = JSON::object();
+    for (auto& [key, group_path] : paths_) {
+        if (!group_path.empty()) groups[key]["g"] = group_path;
+    }
+    for (auto& [key, tags] : tags_) {
+        if (!tags.empty()) groups[key]["t"] = tags;
+    }
+
+    std::ofstream outstream(path);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE TO GROUPS FILE!" << std::endl;
+        return;
+    }
+    outstream << groups.dump() << std::endl;
+    outstream.close();
+
+    std::error_code ec;
+    if (!outstream.fail()) fs::remove(journal_path(path), ec);
+}
+
+
+/*
+ * Saves one entry's group path and tags by appending them to the journal beside the file
+ */
+void
+PassCurses::GroupTree::save_entry(const std::string &path, const std::string &key) const {
+    const auto change = JSON::array({key, group_of(key), tags_of(key)});
+
+    std::ofstream outstream(journal_path(path), std::ios::app);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE TO GROUPS FILE!" << std::endl;
+        return;
+    }
+    outstream << change.dump() << '\n';
+    outstream.close();
+
+    // One full write now and then keeps the journal, and so the next load, short
+    if (outstream.fail() || fs::file_size(journal_path(path)) > JOURNAL_COMPACT_SIZE) save(path);
+}
+
+
+/*
+ * Rebuilds the tree for the vault's current keys, keeping expanded groups expanded
+ */
+void
+PassCurses::GroupTree::sync(const JSON &j) {
+    // Remember which groups were open, by path, across the rebuild
+    std::set<std::vector<std::string>> open;
+    std::vector<Group *> pending {&root_};
+    while (!pending.empty()) {
+        auto *group = pending.back();
+        pending.pop_back();
+        if (group->expanded && group != &root_) open.insert(path_of(group));
+        for (auto& [name, child] : group->children) pending.push_back(child.get());
+    }
+
+    root_.children.clear();
+    root_.entries.clear();
+    for (auto it = paths_.begin(); it != paths_.end();) {
+        if (!j.contains(it->first)) it = paths_.erase(it);
+        else ++it;
+    }
+    for (auto it = tags_.begin(); it != tags_.end();) {
+        if (j.contains(it->first)) {
+            ++it;
+            continue;
+        }
+        for (auto &tag : it->second) erase_sorted(tag_index_[tag], it->first);
+        it = tags_.erase(it);
+    }
+
+    // Keys arrive in order, so each group's entries stay sorted without sorting
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        auto path = paths_.find(it.key());
+        auto *group = (path == paths_.end()) ? &root_ : find_or_create(path->second);
+        group->entries.push_back(it.key());
+    }
+    for (auto &path : open) find_or_create(path)->expanded = true;
+
+    count_rows(&root_);
+}
+
+
+/*
+ * Shows a new entry in the group its path names
+ */
+void
+PassCurses::GroupTree::insert(const std::string &key) {
+    attach(key);
+}
+
+
+/*
+ * Drops a deleted entry along with its group path and tags
+ */
+void
+PassCurses::GroupTree::erase(const std::string &key) {
+    detach(key);
+    paths_.erase(key);
+    set_tags(key, {});
+}
+
+
+/*
+ * Moves an entry to a group, given as encrypted path components; empty means the top level
+ */
+void
+PassCurses::GroupTree::set_group(const std::string &key, const std::vector<std::string> &path) {
+    const bool shown = detach(key);
+    if (path.empty()) paths_.erase(key);
+    else paths_[key] = path;
+    if (shown) attach(key);
+}
+
+
+/*
+ * Replaces an entry's encrypted tags, keeping the tag index up to date
+ */
+void
+PassCurses::GroupTree::set_tags(const std::string &key, const std::vector<std::string> &tags) {
+    for (auto &tag : tags_of(key)) erase_sorted(tag_index_[tag], key);
+
+    if (tags.empty()) tags_.erase(key);
+    else tags_[key] = tags;
+
+    for (auto &tag : tags) insert_sorted(tag_index_[tag], key);
+}
+
+
+const std::vector<std::string> &
+PassCurses::GroupTree::tags_of(const std::string &key) const {
+    auto it = tags_.find(key);
+
+    return it == tags_.end() ? NO_STRINGS : it->second;
+}
+
+
+const std::vector<std::string> &
+PassCurses::GroupTree::group_of(const std::string &key) const {
+    auto it = paths_.find(key);
+
+    return it == paths_.end() ? NO_STRINGS : it->second;
+}
+
+
+/*
+ * Expands or collapses the group on a visible row
+ */
+void
+PassCurses::GroupTree::toggle(std::size_t row) {
+    if (!tag_filter_.empty()) return;  // Filtered rows are all entries
+
+    // Find the header by skipping whole groups, entries always follow a group's subgroups
+    auto *group = &root_;
+    Group *found = nullptr;
+    while (!found) {
+        Group *inside = nullptr;
+        for (auto& [name, child] : group->children) {
+            if (row == 0) {
+                found = child.get();
+                break;
+            }
+            row--;
+            if (!child->expanded) continue;
+            if (row < child->rows) {
+                inside = child.get();
+                break;
+            }
+            row -= child->rows;
+        }
+        if (!found && !inside) return;  // An entry, or past the end
+        if (inside) group = inside;
+    }
+
+    // Its contents appear in or vanish from every open group above it
+    if (found->expanded) {
+        grow(found->parent, -static_cast<std::ptrdiff_t>(found->rows));
+        found->expanded = false;
+    } else {
+        found->expanded = true;
+        grow(found->parent, static_cast<std::ptrdiff_t>(found->rows));
+    }
+}
+
+
+/*
+ * Expands the groups leading to an entry and returns its row
+ */
+std::size_t
+PassCurses::GroupTree::reveal(const std::string &key) {
+    if (!tag_filter_.empty()) {
+        auto it = tag_index_.find(tag_filter_);
+        if (it == tag_index_.end()) return 0;
+        auto slot = std::lower_bound(it->second.begin(), it->second.end(), key);
+
+        return (slot != it->second.end() && *slot == key) ? static_cast<std::size_t>(slot - it->second.begin()) : 0;
+    }
+
+    auto *group = group_holding(key);
+    if (!group) return 0;
+    auto slot = std::lower_bound(group->entries.begin(), group->entries.end(), key);
+    if (slot == group->entries.end() || *slot != key) return 0;
+
+    // Innermost first, so each group's count already holds the ones opened inside it
+    for (auto *closed = group; closed->parent; closed = closed->parent) {
+        if (closed->expanded) continue;
+        closed->expanded = true;
+        grow(closed->parent, static_cast<std::ptrdiff_t>(closed->rows));
+    }
+
+    // Everything before the entry is its group's subgroups, then earlier siblings on the way up
+    auto row = static_cast<std::size_t>(slot - group->entries.begin());
+    for (auto& [name, child] : group->children) row += footprint(child.get());
+    for (; group->parent; group = group->parent) {
+        row++;  // The group's own header
+        for (auto& [name, sibling] : group->parent->children) {
+            if (sibling.get() == group) break;
+            row += footprint(sibling.get());
+        }
+    }
+
+    return row;
+}
+
+
+/*
+ * Up to count rows currently shown from the first one on, either the tree or the
+ * entries matching the tag filter
+ */
+std::vector<PassCurses::GroupTree::Row>
+PassCurses::GroupTree::rows(std::size_t first, std::size_t count) const {
+    std::vector<Row> out;
+    if (!tag_filter_.empty()) {
+        // Straight from the inverted index, no other entry is looked at
+        auto it = tag_index_.find(tag_filter_);
+        if (it == tag_index_.end()) return out;
+        for (auto i = first; i < it->second.size() && out.size() < count; i++) out.push_back({nullptr, it->second[i], 0});
+
+        return out;
+    }
+
+    auto skip = first;
+    append_rows(&root_, 0, skip, count, out);
+
+    return out;
+}
+
+
+/*
+ * Number of rows currently shown
+ */
+std::size_t
+PassCurses::GroupTree::size() const {
+    if (tag_filter_.empty()) return root_.rows;
+    auto it = tag_index_.find(tag_filter_);
+
+    return it == tag_index_.end() ? 0 : it->second.size();
+}
+
+
+/*
+ * Shows only entries carrying the encrypted tag, an empty tag shows the tree again
+ */
+void
+PassCurses::GroupTree::filter_by_tag(const std::string &tag) {
+    tag_filter_ = tag;
+}
+
+
+PassCurses::GroupTree::Group *
+PassCurses::GroupTree::find_or_create(const std::vector<std::string> &path) {
+    auto *group = &root_;
+    for (auto &name : path) {
+        auto &child = group->children[name];
+        if (!child) {
+            child = std::make_unique<Group>();
+            child->name   = name;
+            child->parent = group;
+            grow(group, 1);  // Its header
+        }
+        group = child.get();
+    }
+
+    return group;
+}
+
+
+/*
+ * The group an entry's path leads to, nullptr if the tree has no such group
+ */
+PassCurses::GroupTree::Group *
+PassCurses::GroupTree::group_holding(const std::string &key) {
+    auto path = paths_.find(key);
+    if (path == paths_.end()) return &root_;
+
+    auto *group = &root_;
+    for (auto &name : path->second) {
+        auto child = group->children.find(name);
+        if (child == group->children.end()) return nullptr;
+        group = child->second.get();
+    }
+
+    return group;
+}
+
+
+/*
+ * Takes an entry out of its group, dropping groups it leaves empty; false if it wasn't shown
+ */
+bool
+PassCurses::GroupTree::detach(const std::string &key) {
+    auto *group = group_holding(key);
+    if (!group || !erase_sorted(group->entries, key)) return false;
+    grow(group, -1);
+
+    while (group->parent && group->entries.empty() && group->children.empty()) {
+        auto *parent = group->parent;
+        grow(parent, -1);  // Only its header is left
+        parent->children.erase(group->name);
+        group = parent;
+    }
+
+    return true;
+}
+
+
+/*
+ * Puts an entry into the group its path names, creating groups as needed
+ */
+void
+PassCurses::GroupTree::attach(const std::string &key) {
+    auto path = paths_.find(key);
+    auto *group = (path == paths_.end()) ? &root_ : find_or_create(path->second);
+    if (insert_sorted(group->entries, key)) grow(group, 1);
+}
+
+
+/*
+ * Appends a group's rows to out after skipping the first skip of them, until out holds count.
+ * Open groups that lie wholly before the first row are passed over by their count
+ */
+void
+PassCurses::GroupTree::append_rows(const Group *group, int depth, std::size_t &skip, std::size_t count,
+                                   std::vector<Row> &out) const {
+    for (auto& [name, child] : group->children) {
+        if (out.size() == count) return;
+        if (skip > 0) skip--;
+        else out.push_back({child.get(), "", depth});
+        if (!child->expanded) continue;
+        if (skip >= child->rows) skip -= child->rows;
+        else append_rows(child.get(), depth + 1, skip, count, out);
+    }
+
+    if (skip >= group->entries.size()) {
+        skip -= group->entries.size();
+        return;
+    }
+    for (auto i = skip; i < group->entries.size() && out.size() < count; i++) {
+        out.push_back({nullptr, group->entries[i], depth});
+    }
+    skip = 0;
+}
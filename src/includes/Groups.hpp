@@ -0,0 +1,170 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "json.hpp"
+
+
+namespace PassCurses {
+
+    /*
+     * Group paths and tags of entries, shown as a collapsible tree.
+     *
+     * Visible rows are never materialised. Each group knows how many rows its contents take
+     * when it is open, so finding a row, toggling a group or revealing an entry walks group
+     * headers only and skips whole groups and runs of entries by count.
+     * Group names and tags are kept encrypted like keys and are decrypted only when drawn.
+     */
+    class GroupTree {
+    public:
+        struct Group {
+            std::string                                   name;      // Encrypted path component
+            Group                                        *parent = nullptr;
+            std::map<std::string, std::unique_ptr<Group>> children;  // By encrypted name
+            std::vector<std::string>                      entries;   // Encrypted keys, in key order
+            std::size_t                                   rows = 0;  // Rows its contents take while it is open
+            bool                                          expanded = false;
+        };
+
+        /*
+         * A visible line of the tree: either a group header or an entry
+         */
+        struct Row {
+            const Group *group;  // Set for group headers
+            std::string  key;    // Set for entries
+            int          depth;
+        };
+
+
+        /*
+         * Reads group paths and tags, then the journal of changes saved since; a missing file
+         * means everything is ungrouped
+         */
+        void
+        load(const std::string &path);
+
+
+        /*
+         * Writes every group path and tag, which makes the journal redundant
+         */
+        void
+        save(const std::string &path) const;
+
+
+        /*
+         * Saves one entry's group path and tags by appending them to the journal beside the file
+         */
+        void
+        save_entry(const std::string &path, const std::string &key) const;
+
+
+        /*
+         * Rebuilds the tree for the vault's current keys, keeping expanded groups expanded
+         */
+        void
+        sync(const nlohmann::json &j);
+
+
+        /*
+         * Shows a new entry in the group its path names
+         */
+        void
+        insert(const std::string &key);
+
+
+        /*
+         * Drops a deleted entry along with its group path and tags
+         */
+        void
+        erase(const std::string &key);
+
+
+        /*
+         * Moves an entry to a group, given as encrypted path components; empty means the top level
+         */
+        void
+        set_group(const std::string &key, const std::vector<std::string> &path);
+
+
+        /*
+         * Replaces an entry's encrypted tags, keeping the tag index up to date
+         */
+        void
+        set_tags(const std::string &key, const std::vector<std::string> &tags);
+
+
+        const std::vector<std::string> &
+        tags_of(const std::string &key) const;
+
+
+        const std::vector<std::string> &
+        group_of(const std::string &key) const;
+
+
+        /*
+         * Expands or collapses the group on a visible row
+         */
+        void
+        toggle(std::size_t row);
+
+
+        /*
+         * Expands the groups leading to an entry and returns its row
+         */
+        std::size_t
+        reveal(const std::string &key);
+
+
+        /*
+         * Up to count rows currently shown from the first one on, either the tree or the
+         * entries matching the tag filter
+         */
+        std::vector<Row>
+        rows(std::size_t first, std::size_t count) const;
+
+
+        /*
+         * Number of rows currently shown
+         */
+        std::size_t
+        size() const;
+
+
+        /*
+         * Shows only entries carrying the encrypted tag, an empty tag shows the tree again
+         */
+        void
+        filter_by_tag(const std::string &tag);
+
+
+        const std::string &
+        tag_filter() const { return tag_filter_; }
+
+
+        bool enabled = false;  // Whether the tree is the display order
+
+    private:
+        Group *
+        find_or_create(const std::vector<std::string> &path);
+
+        Group *
+        group_holding(const std::string &key);
+
+        bool
+        detach(const std::string &key);
+
+        void
+        attach(const std::string &key);
+
+        void
+        append_rows(const Group *group, int depth, std::size_t &skip, std::size_t count, std::vector<Row> &out) const;
+
+        Group                                                      root_;
+        std::unordered_map<std::string, std::vector<std::string>> paths_;      // Key to encrypted group path
+        std::unordered_map<std::string, std::vector<std::string>> tags_;       // Key to encrypted tags
+        std::unordered_map<std::string, std::vector<std::string>> tag_index_;  // Encrypted tag to keys, in key order
+        std::string                                                tag_filter_;
+    };
+}
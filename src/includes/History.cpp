@@ -0,0 +1,219 @@
+#include "History.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+using JSON = nlohmann::json;
+
+const std::size_t PassCurses::HISTORY_MAX_VERSIONS = 10;
+const int         PassCurses::HISTORY_MAX_AGE_DAYS = 365;
+const std::size_t PassCurses::HISTORY_PRUNE_SIZE   = 1024 * 1024;  // Log size that triggers a prune on append
+const std::size_t PassCurses::HISTORY_PRUNE_GROWTH = 2;            // Growth over the last pruned size before pruning again
+
+
+namespace {
+
+    /*
+     * Where the log's size after the last prune is kept
+     */
+    std::string
+    pruned_size_path() {
+        return PassCurses::history_file_path() + ".pruned";
+    }
+
+
+    /*
+     * Whether the log has grown enough to be worth rewriting. A log that is still big right
+     * after a prune holds only versions inside the limits, so it has to grow by
+     * HISTORY_PRUNE_GROWTH first, which keeps appends from rewriting it every time
+     */
+    bool
+    prune_due() {
+        std::error_code ec;
+        const auto size = fs::file_size(PassCurses::history_file_path(), ec);
+        if (ec || size <= PassCurses::HISTORY_PRUNE_SIZE) return false;
+
+        std::uintmax_t pruned_size = 0;
+        std::ifstream instream(pruned_size_path());
+        instream >> pruned_size;
+
+        return size > PassCurses::HISTORY_PRUNE_GROWTH * pruned_size;
+    }
+
+
+    /*
+     * The record for a replaced value, less its timestamp. The old value is stored as a delta
+     * against its replacement
+     */
+    JSON
+    history_record(const std::string &key, const std::string &old_value, const std::string &new_value) {
+        // Shared prefix and suffix with the replacement, the middle is stored as-is
+        std::size_t prefix = 0, suffix = 0;
+        while (prefix < old_value.size() && prefix < new_value.size() &&
+               old_value[prefix] == new_value[prefix]) prefix++;
+        while (suffix < old_value.size() - prefix && suffix < new_value.size() - prefix &&
+               old_value[old_value.size()-1-suffix] == new_value[new_value.size()-1-suffix]) suffix++;
+
+        JSON record;
+        record["k"] = key;
+        record["p"] = prefix;
+        record["s"] = suffix;
+        record["m"] = old_value.substr(prefix, old_value.size() - prefix - suffix);
+        record["e"] = new_value.empty();  // Nothing newer to apply the delta to
+
+        return record;
+    }
+}
+
+
+/*
+ * Path of the append-only history log
+ */
+std::string
+PassCurses::history_file_path() {
+    return VAULT_DIRECTORY + "/history.log";
+}
+
+
+/*
+ * Records that an entry's value was replaced; an empty new_value means it was deleted.
+ * The old value is stored as a delta against its replacement
+ */
+void
+PassCurses::record_history(const std::string &key, const std::string &old_value, const std::string &new_value) {
+    if (old_value == new_value) return;
+
+    auto record = history_record(key, old_value, new_value);
+    record["t"] = static_cast<long long>(std::time(nullptr));
+
+    const auto path = history_file_path();
+    std::ofstream outstream(path, std::ios::app);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE TO HISTORY FILE!" << std::endl;
+        return;
+    }
+    outstream << record.dump() << '\n';
+    outstream.close();
+
+    if (prune_due()) prune_history();
+}
+
+
+/*
+ * Removes the newest record if it is the one record_history(key, old_value, new_value) wrote,
+ * e.g. when that change is undone. False, leaving the log alone, if it is not
+ */
+bool
+PassCurses::take_back_history(const std::string &key, const std::string &old_value, const std::string &new_value) {
+    const auto path = history_file_path();
+    std::error_code ec;
+    const auto size = fs::file_size(path, ec);
+    if (ec || size == 0) return false;
+
+    // Read back from the end until the line before the last one ends, records are short
+    std::ifstream instream(path, std::ios::binary);
+    std::string tail;
+    std::uintmax_t start = 0;
+    auto newline = std::string::npos;
+    for (std::uintmax_t chunk = 4096;; chunk *= 2) {
+        start = size > chunk ? size - chunk : 0;
+        tail.resize(static_cast<std::size_t>(size - start));
+        instream.seekg(static_cast<std::streamoff>(start));
+        instream.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+        if (tail.size() >= 2) newline = tail.rfind('\n', tail.size() - 2);
+        if (newline != std::string::npos || start == 0) break;
+    }
+    instream.close();
+
+    const auto line_start = (newline == std::string::npos) ? 0 : newline + 1;
+    auto record = JSON::parse(tail.substr(line_start), nullptr, false);
+    if (!record.is_object()) return false;
+    record.erase("t");
+    if (record != history_record(key, old_value, new_value)) return false;
+
+    fs::resize_file(path, start + line_start, ec);
+
+    return !ec;
+}
+
+
+/*
+ * Loads the previous values of one entry, newest first, by replaying deltas from its current value.
+ * Only versions inside the count and age limits are returned
+ */
+std::vector<PassCurses::HistoryVersion>
+PassCurses::load_history(const std::string &key, const std::string &current_value) {
+    std::ifstream instream(history_file_path());
+    std::vector<JSON> records;
+    std::string line;
+    const std::string needle = JSON(key).dump();
+    while (std::getline(instream, line)) {
+        // Cheap reject before parsing, the key appears verbatim in its own records
+        if (line.find(needle) == std::string::npos) continue;
+        auto record = JSON::parse(line, nullptr, false);
+        if (record.is_discarded() || record.value("k", "") != key) continue;
+        records.push_back(std::move(record));
+    }
+    instream.close();
+
+    const auto cutoff = std::time(nullptr) - static_cast<std::time_t>(HISTORY_MAX_AGE_DAYS) * 24 * 60 * 60;
+    std::vector<HistoryVersion> versions;
+    std::string newer = current_value;
+    for (auto it = records.rbegin(); it != records.rend(); ++it) {
+        const std::string base = (*it)["e"].get<bool>() ? std::string() : newer;
+        const auto prefix = (*it)["p"].get<std::size_t>();
+        const auto suffix = (*it)["s"].get<std::size_t>();
+        if (prefix + suffix > base.size()) break;  // Chain broken, older versions can't be rebuilt
+
+        std::string value = base.substr(0, prefix) + (*it)["m"].get<std::string>() +
+                            base.substr(base.size() - suffix);
+        // The log may hold more until its next prune, the limits apply all the same
+        const auto timestamp = static_cast<std::time_t>((*it)["t"].get<long long>());
+        if (versions.size() == HISTORY_MAX_VERSIONS || timestamp < cutoff) break;
+        versions.push_back({timestamp, value});
+        newer = value;
+    }
+
+    return versions;
+}
+
+
+/*
+ * Rewrites the history log, keeping only versions inside the count and age limits
+ */
+void
+PassCurses::prune_history() {
+    const auto path = history_file_path();
+    std::ifstream instream(path);
+    if (!instream.is_open()) return;
+
+    std::vector<std::string> lines;
+    std::vector<JSON>        records;
+    std::unordered_map<std::string, std::size_t> remaining;  // Versions per key still to skip past
+    std::string line;
+    while (std::getline(instream, line)) {
+        auto record = JSON::parse(line, nullptr, false);
+        if (record.is_discarded()) continue;
+        remaining[record["k"].get<std::string>()]++;
+        lines.push_back(std::move(line));
+        records.push_back(std::move(record));
+    }
+    instream.close();
+
+    // Records are oldest first, and deltas only depend on newer records, so dropping from the front is safe
+    const auto cutoff = std::time(nullptr) - static_cast<std::time_t>(HISTORY_MAX_AGE_DAYS) * 24 * 60 * 60;
+    std::ofstream outstream(path + ".tmp");
+    for (std::size_t i = 0; i < records.size(); i++) {
+        auto &count = remaining[records[i]["k"].get<std::string>()];
+        const bool too_many = count > HISTORY_MAX_VERSIONS;
+        count--;
+        if (too_many || records[i]["t"].get<long long>() < cutoff) continue;
+        outstream << lines[i] << '\n';
+    }
+    outstream.close();
+
+    fs::rename(path + ".tmp", path);
+
+    std::ofstream size_stream(pruned_size_path());
+    size_stream << fs::file_size(path) << '\n';
+}
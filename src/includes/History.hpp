@@ -0,0 +1,63 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <ctime>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+
+namespace PassCurses {
+
+    extern const std::size_t HISTORY_MAX_VERSIONS;
+    extern const int         HISTORY_MAX_AGE_DAYS;
+    extern const std::size_t HISTORY_PRUNE_SIZE;
+    extern const std::size_t HISTORY_PRUNE_GROWTH;
+
+
+    /*
+     * A previous value of an entry, still encrypted
+     */
+    struct HistoryVersion {
+        std::time_t timestamp;
+        std::string value;
+    };
+
+
+    /*
+     * Path of the append-only history log
+     */
+    std::string
+    history_file_path();
+
+
+    /*
+     * Records that an entry's value was replaced; an empty new_value means it was deleted.
+     * The old value is stored as a delta against its replacement
+     */
+    void
+    record_history(const std::string &key, const std::string &old_value, const std::string &new_value);
+
+
+    /*
+     * Removes the newest record if it is the one record_history(key, old_value, new_value) wrote,
+     * e.g. when that change is undone. False, leaving the log alone, if it is not
+     */
+    bool
+    take_back_history(const std::string &key, const std::string &old_value, const std::string &new_value);
+
+
+    /*
+     * Loads the previous values of one entry, newest first, by replaying deltas from its current value.
+     * Only versions inside the count and age limits are returned
+     */
+    std::vector<HistoryVersion>
+    load_history(const std::string &key, const std::string &current_value);
+
+
+    /*
+     * Rewrites the history log, keeping only versions inside the count and age limits. Appends
+     * call it once the log is past HISTORY_PRUNE_SIZE and HISTORY_PRUNE_GROWTH times its size
+     * after the last prune
+     */
+    void
+    prune_history();
+}
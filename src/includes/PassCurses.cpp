@@ -1,38 +1,27 @@
 #include "PassCurses.hpp"
-#include "json.hpp"
 
-namespace fs = std::filesystem;
 using namespace PassCurses;
 
 using JSON = nlohmann::json;
 
-const int WIDTH     = 30;
-const int HEIGHT    = 13;
-const int BOX_SPACE = 11;
+const int LAYOUT_MIN_WIDTH = 30;
+const int LAYOUT_MAX_WIDTH = 100;  // Wider than this and key and password drift too far apart to read
+const int RESIZE_SETTLE_MS = 50;   // Quiet time that ends a burst of resize events
 
+PassCurses::Layout LAYOUT;
+PassCurses::WarmCacheBuilder WARM_CACHE_BUILDER;
 
-/*
- * Encrypts messages with XOR encryption
- */
-inline std::string
-PassCurses::encrypt(std::string message, const int &CYPHER_KEY) {
-    for (auto &ch : message ) ch ^= CYPHER_KEY;
-
-    return message;
-}
-
-
-/*
- * Decrypts XOR-encrypted messages
- */
-inline std::string
-PassCurses::decrypt(std::string message, const int &CYPHER_KEY) { return encrypt(std::move(message), CYPHER_KEY); }
+PassCurses::UsageIndex USAGE_INDEX;
+PassCurses::BreachIndex BREACH_INDEX;
+PassCurses::BreachChecker BREACH_CHECKER(BREACH_INDEX);
+PassCurses::GroupTree GROUP_TREE;
+PassCurses::CommandLog COMMAND_LOG;
 
 
 /*
  * Sets up ncurses, clearing screen, turn off echoing, initialize colours, hide cursor
  */
-inline void
+void
 PassCurses::initialize_ncurses() {
     initscr();
     clear();
@@ -57,13 +46,10 @@ PassCurses::initialize_ncurses() {
 }
 
 
-inline WINDOW*
+WINDOW*
 PassCurses::initialize_ncurses_window() {
-    int rows, cols;
-    getmaxyx(stdscr, rows, cols);
-    const auto START_Y = (rows / 2) - (HEIGHT);
-    const auto START_X = (cols / 2) - (WIDTH / 2);
-    WINDOW *password_win = newwin(HEIGHT, WIDTH, START_Y, START_X);
+    LAYOUT = compute_layout();
+    WINDOW *password_win = newwin(LAYOUT.height, LAYOUT.width, LAYOUT.start_y, LAYOUT.start_x);
     wbkgd(password_win, COLOR_PAIR(1));
     wbkgd(stdscr, COLOR_PAIR(1));
     refresh();
@@ -75,20 +61,46 @@ PassCurses::initialize_ncurses_window() {
 
 
 /*
- * Redraws window, computes new dimensions
+ * Places the password box for the current terminal size: prompts on top, the box filling
+ * the rest of the height, and a help hint underneath
  */
-inline std::tuple<const int, const int>
-PassCurses::resize_redraw() {
-    clear();
-    endwin();
-    refresh();
+PassCurses::Layout
+PassCurses::compute_layout() {
+    int rows, columns;
+    getmaxyx(stdscr, rows, columns);
+
+    Layout layout;
+    layout.width      = std::max(std::min(columns - 4, LAYOUT_MAX_WIDTH), std::min(columns, LAYOUT_MIN_WIDTH));
+    layout.start_y    = 3;                           // Border, then two prompt rows
+    layout.height     = std::max(3, rows - layout.start_y - 2);  // Help hint and border below
+    layout.start_x    = std::max(0, (columns - layout.width) / 2);
+    layout.box_space  = layout.height - 2;
+    layout.prompt_row = layout.start_y - 1;
+    layout.prompt_col = layout.start_x;
+    layout.help_row   = layout.start_y + layout.height;
+
+    return layout;
+}
 
-    int resize_rows, resize_columns;
-    getmaxyx(stdscr, resize_rows, resize_columns);
-    const auto new_X = (resize_columns / 2) - (WIDTH / 2);
-    const auto new_Y = (resize_rows / 2) - (HEIGHT);
 
-    return {new_Y, new_X};
+/*
+ * Waits out a burst of resize events, then lays out the one password window again in place
+ */
+void
+PassCurses::resize_redraw(WINDOW *password_win) {
+    // Dragging a terminal corner sends a stream of KEY_RESIZE, only the last size matters
+    timeout(RESIZE_SETTLE_MS);
+    int next;
+    while ((next = getch()) == KEY_RESIZE) {}
+    if (next != ERR) ungetch(next);
+    timeout(-1);
+
+    LAYOUT = compute_layout();
+    // Move out of the way first, a window can't be moved or grown past the screen edge
+    mvwin(password_win, 0, 0);
+    wresize(password_win, LAYOUT.height, LAYOUT.width);
+    mvwin(password_win, LAYOUT.start_y, LAYOUT.start_x);
+    clear();
 }
 
 
@@ -99,7 +111,7 @@ PassCurses::create_rc(const int &CYPHER_KEY) {
     ch = getchar();
     if (ch != 'y') std::exit(EXIT_FAILURE);
 
-    std::ofstream outstream(HOME_DIRECTORY + "/.passcurses/passrc");
+    std::ofstream outstream(passrc_path());
     if (!outstream.is_open()) {
         std::cout << "COULD NOT CREATE FILE!\n";
         std::exit(EXIT_FAILURE);
@@ -124,17 +136,7 @@ PassCurses::create_rc(const int &CYPHER_KEY) {
 }
 
 
-inline std::string
-PassCurses::get_home_directory() {
-    struct passwd *pwd = getpwuid(getuid());
-
-    const char* home_directory = pwd->pw_dir;
-
-    return std::string(home_directory);
-}
-
-
-inline void
+void
 PassCurses::create_data_directory(const std::string &home_directory) {
     int choice;
     std::cout << "Create new directory for data files? [y]es/[n]o \n";
@@ -150,26 +152,6 @@ PassCurses::create_data_directory(const std::string &home_directory) {
 }
 
 
-/*
- * Getting master password from user, comparing to file
- */
-std::string
-PassCurses::read_master_password(const int &CYPHER_KEY) {
-    std::ifstream instream(HOME_DIRECTORY + "/.passcurses/passrc");
-    if (instream.fail()) {
-        std::cerr << "CANNOT OPEN PASSRC" << std::endl;
-    }
-
-    std::string master_password;
-    std::getline(instream, master_password);
-    instream.close();
-
-    const std::string final_master_password = decrypt(master_password, CYPHER_KEY);
-
-    return final_master_password;
-}
-
-
 /*
  * Getting the cypher key from the user
  */
@@ -245,32 +227,42 @@ PassCurses::print_passwords(WINDOW *password_win, int highlight, JSON &j, const
     auto x = 2, y = 1; // Positions for printed passwords
 
     // If highlight goes higher than box height, then "scrolling" is required
-    auto scroll_down_amount = (highlight - BOX_SPACE);
+    auto scroll_down_amount = (highlight - LAYOUT.box_space);
 
     wclear(password_win);  // Clear the window for renewal
 
-    int rows, columns;
-    getmaxyx(stdscr, rows, columns);
     box(stdscr, 0, 0);
     refresh();
     box(password_win, 0, 0);
 
-    const auto print_help_line   = ((rows/2) + static_cast<int>(HEIGHT*.05));
-    const auto print_help_column = ((columns/2) - (WIDTH/2));
-    mvprintw(print_help_line, print_help_column, "%s", "press 'h' to toggle help");
-    mvwprintw(password_win, 0, x, "%s", "PASSWORDS");
+    mvprintw(LAYOUT.help_row, LAYOUT.start_x, "%s", "press 'h' for help");
+    auto title = (VAULT_NAME == DEFAULT_VAULT ? std::string("PASSWORDS") : VAULT_NAME);
+    if (!GROUP_TREE.tag_filter().empty()) title += " #" + decrypt(GROUP_TREE.tag_filter(), CYPHER_KEY);
+    else if (GROUP_TREE.enabled) title += " (tree)";
+    else if (USAGE_INDEX.enabled) title += " (frecent)";
+    mvwprintw(password_win, 0, x, "%s", title.c_str());
+
+    // Skip the entries above the "view" of passwords, this creates the scrolling effect
+    const auto first_visible = std::max(0, scroll_down_amount);
+    highlight -= first_visible;
 
     auto i = 0;
-    for (auto& [key, value] : j.items()) {
-        // Stop printing once box is "filled"
-        if (i == BOX_SPACE) break;
-        // Iterate through lines until "view" of passwords is correct
-        // This creates the scrolling effect
-        if (scroll_down_amount > 0) {
-            scroll_down_amount--;
-            highlight--;
+    for (auto &row : rows_in_view(j, first_visible, LAYOUT.box_space)) {
+        // Group headers only need their own name decrypted, their entries stay untouched
+        if (row.group) {
+            if (highlight == i+2) wattron(password_win, A_STANDOUT);
+            mvwprintw(password_win, y, x + 2*row.depth, "%s %s/",
+                      row.group->expanded ? "-" : "+",
+                      decrypt(row.group->name, CYPHER_KEY).c_str());
+            if (highlight == i+2) wattroff(password_win, A_STANDOUT);
+            i++;
+            y++;
             continue;
         }
+
+        const auto &key   = row.key;
+        const auto &value = j[key];
+        const auto x      = 2 + 2*row.depth;
         // Print highlighted line
         if (highlight == i+2) {
             wattron(password_win, A_STANDOUT);
@@ -302,6 +294,9 @@ PassCurses::print_passwords(WINDOW *password_win, int highlight, JSON &j, const
                        key.c_str(),
                        value.get<std::string>().c_str());
 
+        // Flag passwords found in the breach corpus in the left margin
+        if (BREACH_CHECKER.occurrences(key)) mvwaddch(password_win, y, x-1, '!');
+
         i++;
         y++;
     }
@@ -311,18 +306,17 @@ PassCurses::print_passwords(WINDOW *password_win, int highlight, JSON &j, const
 
 
 /*
- * Writes edited JSON to file
+ * Reads a password file in either the plain or the compressed format
  */
-void
-PassCurses::write_to_file(JSON &j) {
-    std::ofstream outstream(HOME_DIRECTORY + "/.passcurses/testing.json");
-    if (!outstream.is_open()) {
-        std::cerr << "CAN'T WRITE TO FILE!" << std::endl;
-        return;
+JSON
+PassCurses::read_vault(std::istream &instream, const int &CYPHER_KEY) {
+    JSON j;
+    if (!load_vault(instream, CYPHER_KEY, j)) {
+        std::cerr << "PASSWORD FILE IS CORRUPT!" << std::endl;
+        std::exit(EXIT_FAILURE);
     }
 
-    outstream << std::setw(4) << j << std::endl;
-    outstream.close();
+    return j;
 }
 
 
@@ -332,22 +326,8 @@ PassCurses::write_to_file(JSON &j) {
 bool
 PassCurses::add_password(JSON &j, WINDOW *password_win, const int &CYPHER_KEY) {
 
-    int rows, columns;
-    getmaxyx(stdscr, rows, columns);
-    const auto ROWS = (rows/2)-(HEIGHT+1);
-    const auto COLS = (columns/2)-(WIDTH/2);
-
-    std::ifstream instream;
-    instream.open(HOME_DIRECTORY + "/.passcurses/testing.json");
-    if (!instream.is_open()) {
-        std::cerr << "FILE NOT FOUND!" << std::endl;
-        return false;
-    }
-
-    // If there's already a file with some data in, read it in
-    if (instream.peek() != std::ifstream::traits_type::eof()) instream >> j;
-
-    instream.close();
+    const auto ROWS = LAYOUT.prompt_row;
+    const auto COLS = LAYOUT.prompt_col;
 
     curs_set(1);
     char key[30];
@@ -390,11 +370,10 @@ PassCurses::add_password(JSON &j, WINDOW *password_win, const int &CYPHER_KEY) {
 
     tcsetattr(STDIN_FILENO, TCSANOW, &old_term);
 
-    std::string final_key = encrypt(empty_test, CYPHER_KEY);
-    std::string final_password = encrypt(empty_pass_test, CYPHER_KEY);
-    j[final_key]= final_password; // setting the new/overridden value
-
-    write_to_file(j);
+    const auto final_key = encrypt(empty_test, CYPHER_KEY);
+    COMMAND_LOG.run(j, GROUP_TREE, password_command(j, final_key, encrypt(empty_pass_test, CYPHER_KEY)), CYPHER_KEY);
+    USAGE_INDEX.insert(final_key);
+    BREACH_CHECKER.submit(final_key, empty_pass_test);
     curs_set(0);
 
     return true;
@@ -407,7 +386,7 @@ PassCurses::add_password(JSON &j, WINDOW *password_win, const int &CYPHER_KEY) {
 void
 PassCurses::create_password_file(const int &CYPHER_KEY) {
     JSON j;
-    std::ofstream outstream(get_home_directory() + "/.passcurses/testing.json");
+    std::ofstream outstream(vault_file_path());
 
     std::string key, value;
     std::cout << "Enter test key: ";
@@ -432,10 +411,8 @@ PassCurses::create_password_file(const int &CYPHER_KEY) {
 std::string
 PassCurses::generate_password(WINDOW *password_win) {
     char char_passw_len[10];
-    int columns, rows;
-    getmaxyx(stdscr, rows, columns);
-    const auto ROWS = (rows/2)-(HEIGHT+1);
-    const auto COLS = (columns/2)-(WIDTH/2);
+    const auto ROWS = LAYOUT.prompt_row;
+    const auto COLS = LAYOUT.prompt_col;
 
     mvprintw(ROWS, COLS, "%s", "                              ");
     mvprintw(ROWS, COLS, "%s", "Enter length of new password: ");
@@ -456,25 +433,9 @@ PassCurses::generate_password(WINDOW *password_win) {
     wrefresh(password_win);
     refresh();
 
-    // RNG logic
-    std::random_device rd;
-    std::mt19937 rng(rd());
-    std::uniform_int_distribution<int> uni(48,122);
-
-    char passw[passw_len+1]; // This will hold our randomly-generated characters
-    char ch;
-    for (auto i = 0; i <= passw_len; i++) {
-        ch = uni(rng);
-        if ((ch > 90 && ch < 97) || (ch > 57 && ch < 65)) {
-            i--;
-            continue;
-        }
-        passw[i] = ch;
-    }
-
-    passw[passw_len+1] = '\0';
+    if (passw_len <= 0) return "";
 
-    return std::string(passw);
+    return random_password(static_cast<std::size_t>(passw_len));
 }
 
 
@@ -483,21 +444,9 @@ PassCurses::generate_password(WINDOW *password_win) {
  */
 bool
 PassCurses::new_random_password(JSON &j, WINDOW *password_win, const int &CYPHER_KEY) {
-    int columns, rows;
-    getmaxyx(stdscr, rows, columns);
-    const auto ROWS = (rows/2)-(HEIGHT+1);
-    const auto COLS = (columns/2)-(WIDTH/2);
-
-    std::ifstream instream;
-    instream.open(HOME_DIRECTORY + "/.passcurses/testing.json");
-    if (!instream.is_open()) {
-        std::cerr << "FILE NOT FOUND!" << std::endl;
-        std::exit(1);
-    }
-
-    if (instream.peek() != std::ifstream::traits_type::eof()) instream >> j;
+    const auto ROWS = LAYOUT.prompt_row;
+    const auto COLS = LAYOUT.prompt_col;
 
-    instream.close();
     char key[30];
     mvprintw(ROWS, COLS, "%s", "Enter key for your password: ");
     getstr(key);
@@ -518,9 +467,10 @@ PassCurses::new_random_password(JSON &j, WINDOW *password_win, const int &CYPHER
     std::string passw = generate_password(password_win);
     if (passw.empty()) return false;
 
-    std::string final_key = encrypt(key, CYPHER_KEY);
-    std::string final_passw = encrypt(passw, CYPHER_KEY);
-    j[final_key] = final_passw; // setting the new/overridden value
+    const auto final_key = encrypt(key, CYPHER_KEY);
+    COMMAND_LOG.run(j, GROUP_TREE, password_command(j, final_key, encrypt(passw, CYPHER_KEY)), CYPHER_KEY);
+    USAGE_INDEX.insert(final_key);
+    BREACH_CHECKER.submit(final_key, passw);
 
     return true;
 }
@@ -529,8 +479,7 @@ PassCurses::new_random_password(JSON &j, WINDOW *password_win, const int &CYPHER
 JSON
 PassCurses::open_password_file(const int &CYPHER_KEY) {
     JSON j;
-    std::string home_directory = get_home_directory();
-    std::ifstream instream(home_directory + "/.passcurses/testing.json");
+    std::ifstream instream(vault_file_path());
     if (instream.fail()) {
         instream.close();
         int ch;
@@ -538,8 +487,8 @@ PassCurses::open_password_file(const int &CYPHER_KEY) {
         ch = getchar();
         if (ch == 'y') {
             create_password_file(CYPHER_KEY);
-            std::ifstream new_instream(home_directory + "/.passcurses/testing.json");
-            new_instream >> j;
+            std::ifstream new_instream(vault_file_path());
+            j = read_vault(new_instream, CYPHER_KEY);
             new_instream.close();
             return j;
         } else {
@@ -548,7 +497,7 @@ PassCurses::open_password_file(const int &CYPHER_KEY) {
         }
     }
 
-    instream >> j;
+    j = read_vault(instream, CYPHER_KEY);
     instream.close();
     return j;
 }
@@ -558,25 +507,57 @@ PassCurses::open_password_file(const int &CYPHER_KEY) {
  * Copy currently highlighted password to clipboard
  */
 void
-inline PassCurses::copy_password_to_clipboard(JSON &j, const int &highlight, const int &CYPHER_KEY) {
-    auto index = 0;
-    std::string password, command,
-                first_part = "echo -n ",
-                second_part = " | xclip -selection clipboard";
-
-    for (auto& [key, value] : j.items()) {
-        if (++index != (highlight-1)) continue;
-        password = decrypt(value.get<std::string>(), CYPHER_KEY);
-        break;
-    }
+PassCurses::copy_password_to_clipboard(JSON &j, const int &highlight, const int &CYPHER_KEY) {
+    const auto key = key_at_highlight(j, highlight);
+    if (key.empty()) return;
+    USAGE_INDEX.touch(key);
 
-    command = first_part + password + second_part;
-    std::system(command.c_str());
+    copy_to_clipboard(decrypt(j[key].get<std::string>(), CYPHER_KEY));
 }
 
 
+/*
+ * Puts text on the clipboard without passing it through a shell
+ */
+void
+PassCurses::copy_to_clipboard(const std::string &text) {
+    FILE *clipboard = popen("xclip -selection clipboard", "w");
+    if (!clipboard) return;
+    std::fwrite(text.data(), 1, text.size(), clipboard);
+    pclose(clipboard);
+}
+
+
+/*
+ * Copy one field of the highlighted entry to clipboard, the current code for a TOTP seed
+ */
+bool
+PassCurses::copy_field_to_clipboard(JSON &j, int highlight, Field field, const int &CYPHER_KEY) {
+    const auto key = key_at_highlight(j, highlight);
+    if (key.empty()) return false;
+
+    return copy_field_to_clipboard(key, field, CYPHER_KEY);
+}
+
+
+/*
+ * Copy one field of an entry given by its encrypted key, the current code for a TOTP seed
+ */
 bool
-inline PassCurses::print_help_message(bool help_printed) {
+PassCurses::copy_field_to_clipboard(const std::string &key, Field field, const int &CYPHER_KEY) {
+    auto value = read_field(field, key, CYPHER_KEY);
+    if (field == Field::TotpSeed && !value.empty()) value = totp_code(value, std::time(nullptr));
+    if (value.empty()) return false;
+
+    USAGE_INDEX.touch(key);
+    copy_to_clipboard(value);
+
+    return true;
+}
+
+
+void
+PassCurses::print_help_message(WINDOW *password_win) {
     static const std::vector<std::string> HELP_STRINGS {
             "'j' to scroll down",
             "'k' to scroll up",
@@ -589,71 +570,62 @@ inline PassCurses::print_help_message(bool help_printed) {
             "'G' to jump to the bottom",
             "'M' to jump to the middle",
             "'D' to delete a password",
-            "'/' to search for a key"
+            "'/' to search for a key",
+            "'H' to show password history",
+            "'o' to toggle most-used ordering",
+            "'A' to audit for weak/reused passwords",
+            "'!' marks passwords found in a breach",
+            "'V' to switch to another vault",
+            "'t' to toggle the group tree",
+            "'space' to open/close a group",
+            "'e' to edit group and tags",
+            "'#' to show one tag only",
+            "'i' to show username/url/notes/TOTP",
+            "'U' to copy username",
+            "'T' to copy TOTP code",
+            "'u' to undo, 'ctrl-r' to redo"
     };
-    int cols, rows;
-    getmaxyx(stdscr, rows, cols);
-    auto starting_row = static_cast<int>(std::round(rows/2)+(HEIGHT*0.05));
-    const auto starting_col = (cols/2)-(WIDTH/2);
-    if (!help_printed) {
-        for (auto & str : HELP_STRINGS) {
-            mvprintw(++starting_row, starting_col, "%s", str.c_str());
-        }
-        help_printed = true;
-    } else {
-        clear();
-        help_printed = false;
-    }
-
-    return help_printed;
+    // The box takes the whole height now, so help gets its own scrollable window
+    show_report(password_win, "HELP", HELP_STRINGS);
 }
 
+/*
+ * Delete a password entry in the JSON file, 'u' brings it back
+ */
 bool
 PassCurses::delete_password_entry(JSON &j, int highlight, const int &CYPHER_KEY) {
-    int choice;
-    int rows, columns;
-    getmaxyx(stdscr, rows, columns);
-    const auto ROWS = (rows/2)-(HEIGHT+1);
-    const auto COLS = (columns/2)-(WIDTH/2);
-
-    mvprintw(ROWS, COLS, "%s", "Delete password? [y]es/[n]o ");
-    choice = mvgetch(ROWS, COLS+22);
-    mvprintw(ROWS, COLS, "%s", "                            ");
-
-    if (choice == 'n') return false;
-    else {
-        auto indx = 0;
-        std::string deleted_key;
-        for (auto& [key, value] : j.items()) {
-            indx++;
-            if (indx+1 < highlight) continue;
-            mvprintw(ROWS, COLS, "%s", "Confirm deletion: [y]es/[n]o ");
-            choice = getch();
-            if (choice == 'n') {
-                mvprintw(ROWS, COLS, "%s", "                                         ");
-                return false;
-            }
-            deleted_key = key;
-            j.erase(key);
-            break;
-        }
-        mvprintw(ROWS, COLS, "%s", "                                         ");
-        mvprintw(ROWS, COLS, "'%s' %s", decrypt(deleted_key, CYPHER_KEY).c_str(), "password deleted!");
-        getch();
-        mvprintw(ROWS, COLS, "%s", "                                         ");
-        write_to_file(j);
-    }
+    // No confirmation, the delete is a command like any other and undoes the same way
+    const std::string deleted_key = key_at_highlight(j, highlight);
+    if (deleted_key.empty()) return false;
+
+    COMMAND_LOG.run(j, GROUP_TREE, delete_command(j, GROUP_TREE, USAGE_INDEX, deleted_key), CYPHER_KEY);
+    USAGE_INDEX.erase(deleted_key);
 
     return true;
+}
 
+
+/*
+ * Undoes the last change, or redoes the last undone one, and follows the entry it touched
+ */
+std::string
+PassCurses::undo_last_change(JSON &j, int &highlight, const int &CYPHER_KEY, bool redo) {
+    const auto *command = redo ? COMMAND_LOG.redo(j, GROUP_TREE, CYPHER_KEY)
+                               : COMMAND_LOG.undo(j, GROUP_TREE, CYPHER_KEY);
+    if (!command) return redo ? "nothing to redo" : "nothing to undo";
+
+    // Only an entry coming or going moves the frecency order, either way it is the one key
+    if (j.contains(command->key)) USAGE_INDEX.insert(command->key, (redo ? command->after : command->before).usage);
+    else USAGE_INDEX.erase(command->key);
+    if (j.contains(command->key)) highlight = static_cast<int>(position_of(j, command->key)) + 2;
+
+    return std::string(redo ? "redone: " : "undone: ") + describe_command(*command, CYPHER_KEY);
 }
 
 int
 PassCurses::search_for_password(JSON &j, int highlight, const int &CYPHER_KEY) {
-    int rows, columns;
-    getmaxyx(stdscr, rows, columns);
-    const auto ROWS = (rows/2)-(HEIGHT+1);
-    const auto COLS = (columns/2)-(WIDTH/2);
+    const auto ROWS = LAYOUT.prompt_row;
+    const auto COLS = LAYOUT.prompt_col;
 
     char search_chars[30];
     mvprintw(ROWS, COLS, "%s", "Enter a key to search:       ");
@@ -664,11 +636,498 @@ PassCurses::search_for_password(JSON &j, int highlight, const int &CYPHER_KEY) {
     std::string search_key(search_chars);
     mvprintw(ROWS, COLS, "%s", "                                     ");
 
-    auto it = j.find(decrypt(search_key, CYPHER_KEY));
-    if (it != j.end()) {
-        highlight = std::distance(j.begin(), it) + 2;
+    if (search_key.empty()) return highlight;
+
+    // An exact key wins, otherwise the most frecent key containing the search text
+    const auto found = find_entry(j, search_key, CYPHER_KEY, USAGE_INDEX);
+    if (found.empty()) return highlight;
+
+    return static_cast<int>(position_of(j, found)) + 2;
+
+}
+
+
+/*
+ * Encrypted key of the entry shown at a highlight position, empty if there is none
+ */
+std::string
+PassCurses::key_at_highlight(JSON &j, int highlight) {
+    const auto keys = keys_in_view(j, highlight - 2, 1);  // Row 1 is the title, entries start at 2
+
+    return keys.empty() ? "" : keys.front();
+}
+
+
+/*
+ * Encrypted keys of up to count rows in display order, starting from first; group headers give empty keys
+ */
+std::vector<std::string>
+PassCurses::keys_in_view(JSON &j, int first, int count) {
+    std::vector<std::string> keys;
+    for (auto &row : rows_in_view(j, first, count)) keys.push_back(row.key);
+
+    return keys;
+}
+
+
+/*
+ * Up to count rows in display order, starting from first
+ */
+std::vector<PassCurses::GroupTree::Row>
+PassCurses::rows_in_view(JSON &j, int first, int count) {
+    std::vector<GroupTree::Row> rows;
+    if (first < 0 || first >= static_cast<int>(view_size(j))) return rows;
+
+    if (tree_view_active()) return GROUP_TREE.rows(first, count);
+
+    if (USAGE_INDEX.enabled) {
+        const auto &order = USAGE_INDEX.order();
+        const auto last   = std::min<std::size_t>(order.size(), first + count);
+        for (auto k = order.begin() + first; k != order.begin() + last; ++k) rows.push_back({nullptr, *k, 0});
+        return rows;
+    }
+
+    auto it = j.begin();
+    std::advance(it, first);
+    for (; it != j.end() && static_cast<int>(rows.size()) < count; ++it) rows.push_back({nullptr, it.key(), 0});
+
+    return rows;
+}
+
+
+/*
+ * Display position of an entry, in whichever order is active
+ */
+std::size_t
+PassCurses::position_of(JSON &j, const std::string &key) {
+    if (tree_view_active()) return GROUP_TREE.reveal(key);
+    if (USAGE_INDEX.enabled) return USAGE_INDEX.position(key);
+
+    return std::distance(j.begin(), j.find(key));
+}
+
+
+/*
+ * Number of rows the active view shows
+ */
+std::size_t
+PassCurses::view_size(JSON &j) {
+    if (tree_view_active()) return GROUP_TREE.size();
+
+    return j.size();
+}
+
+
+bool
+PassCurses::tree_view_active() {
+    return GROUP_TREE.enabled || !GROUP_TREE.tag_filter().empty();
+}
+
+
+/*
+ * Prompts for the highlighted entry's group path and tags
+ */
+void
+PassCurses::edit_groups(JSON &j, int highlight, const int &CYPHER_KEY) {
+    const auto key = key_at_highlight(j, highlight);
+    if (key.empty()) return;
+
+    const auto ROWS = LAYOUT.prompt_row;
+    const auto COLS = LAYOUT.prompt_col;
+
+    // Show the current values so they can be retyped with changes
+    auto join = [&](const std::vector<std::string> &parts, const char *separator) {
+        std::string joined;
+        for (auto &part : parts) joined += (joined.empty() ? "" : separator) + decrypt(part, CYPHER_KEY);
+        return joined;
+    };
+    auto split = [&](const std::string &text, char separator) {
+        std::vector<std::string> parts;
+        std::stringstream stream(text);
+        std::string part;
+        while (std::getline(stream, part, separator)) {
+            if (!part.empty()) parts.push_back(encrypt(part, CYPHER_KEY));
+        }
+        return parts;
+    };
+
+    char group_chars[60], tag_chars[60];
+    curs_set(1);
+    echo();
+    mvprintw(ROWS-1, COLS, "Now: %s [%s]", join(GROUP_TREE.group_of(key), "/").c_str(),
+             join(GROUP_TREE.tags_of(key), " ").c_str());
+    mvprintw(ROWS, COLS, "%s", "Group (a/b/c): ");
+    getnstr(group_chars, sizeof group_chars - 1);
+    move(ROWS, COLS);
+    clrtoeol();
+    mvprintw(ROWS, COLS, "%s", "Tags (space separated): ");
+    getnstr(tag_chars, sizeof tag_chars - 1);
+    noecho();
+    curs_set(0);
+    move(ROWS-1, COLS);
+    clrtoeol();
+    move(ROWS, COLS);
+    clrtoeol();
+
+    COMMAND_LOG.run(j, GROUP_TREE, groups_command(GROUP_TREE, key, split(group_chars, '/'), split(tag_chars, ' ')), CYPHER_KEY);
+}
+
+
+/*
+ * Prompts for a tag and shows only the entries carrying it, an empty tag clears the filter
+ */
+void
+PassCurses::filter_by_tag(const int &CYPHER_KEY) {
+    const auto ROWS = LAYOUT.prompt_row;
+    const auto COLS = LAYOUT.prompt_col;
+
+    char tag_chars[30];
+    echo();
+    mvprintw(ROWS, COLS, "%s", "Show tag: ");
+    getnstr(tag_chars, sizeof tag_chars - 1);
+    noecho();
+    move(ROWS, COLS);
+    clrtoeol();
+
+    const std::string tag(tag_chars);
+    GROUP_TREE.filter_by_tag(tag.empty() ? "" : encrypt(tag, CYPHER_KEY));
+}
+
+
+/*
+ * Shows lines of text in a scrollable window over the password box
+ */
+void
+PassCurses::show_report(WINDOW *password_win, const std::string &title, const std::vector<std::string> &lines) {
+    WINDOW *report_win = nullptr;
+    int height = 0, width = 0;
+    // Placed again after every resize, once the password box has been laid out for the new size
+    const auto place = [&]() {
+        if (report_win) delwin(report_win);
+        int rows, columns;
+        getmaxyx(stdscr, rows, columns);
+        int box_rows, box_columns;
+        getmaxyx(password_win, box_rows, box_columns);
+        // Reports are wider than a password line, so use most of the screen
+        height = std::max(box_rows, rows - 4);
+        width  = std::max(box_columns, columns - 4);
+        report_win = newwin(height, width, (rows - height) / 2, (columns - width) / 2);
+        wbkgd(report_win, COLOR_PAIR(1));
+    };
+    place();
+
+    auto top = 0;
+    for (;;) {
+        const auto visible = height - 2;
+        wclear(report_win);
+        box(report_win, 0, 0);
+        mvwprintw(report_win, 0, 2, "%s", title.c_str());
+        for (auto i = top; i < static_cast<int>(lines.size()) && i - top < visible; i++) {
+            mvwaddnstr(report_win, 1 + i - top, 2, lines[i].c_str(), width - 4);
+        }
+        mvwprintw(report_win, height - 1, 2, "%s", "j/k:scroll q:back");
+        wrefresh(report_win);
+
+        const auto choice = getch();
+        if (choice == 'q') break;
+        if (choice == KEY_RESIZE) {
+            resize_redraw(password_win);
+            refresh();
+            place();
+        }
+        if ((choice == 'j' || choice == KEY_DOWN) && top + visible < static_cast<int>(lines.size())) top++;
+        if ((choice == 'k' || choice == KEY_UP) && top > 0) top--;
+    }
+
+    delwin(report_win);
+}
+
+
+/*
+ * Shows previous versions of the highlighted entry and restores one if chosen
+ */
+bool
+PassCurses::show_history(JSON &j, WINDOW *password_win, int highlight, const int &CYPHER_KEY) {
+    const auto key = key_at_highlight(j, highlight);
+    if (key.empty()) return false;
+
+    // History is only read from disk here, never when the vault is opened
+    const auto versions = load_history(key, j[key].get<std::string>());
+
+    WINDOW *history_win = nullptr;
+    int rows = 0, columns = 0;
+    // Covers the password box, so it follows the box when the terminal is resized
+    const auto place = [&]() {
+        if (history_win) delwin(history_win);
+        getmaxyx(password_win, rows, columns);
+        int start_y, start_x;
+        getbegyx(password_win, start_y, start_x);
+        history_win = newwin(rows, columns, start_y, start_x);
+        wbkgd(history_win, COLOR_PAIR(1));
+    };
+    place();
+
+    auto selected = 0;
+    auto revealed = false;
+    auto restored = false;
+    for (;;) {
+        wclear(history_win);
+        box(history_win, 0, 0);
+        mvwprintw(history_win, 0, 2, "HISTORY: %s", decrypt(key, CYPHER_KEY).c_str());
+        if (versions.empty()) mvwprintw(history_win, 1, 2, "%s", "no previous versions");
+
+        // Keep the selection on screen, the list scrolls like the password box
+        const auto visible = rows - 2;
+        const auto first   = std::max(0, selected - visible + 1);
+        for (auto i = first; i < static_cast<int>(versions.size()) && i - first < visible; i++) {
+            char stamp[20];
+            std::strftime(stamp, sizeof stamp, "%Y-%m-%d %H:%M", std::localtime(&versions[i].timestamp));
+            if (i == selected) wattron(history_win, A_STANDOUT);
+            mvwprintw(history_win, 1 + i - first, 2, "%s %s", stamp,
+                      (i == selected && revealed) ? decrypt(versions[i].value, CYPHER_KEY).c_str()
+                                                  : versions[i].value.c_str());
+            if (i == selected) wattroff(history_win, A_STANDOUT);
+        }
+        mvwprintw(history_win, rows - 1, 2, "%s", "d:show r:restore q:back");
+        wrefresh(history_win);
+
+        const auto choice = getch();
+        if (choice == 'q' || choice == 'H') break;
+        if (choice == KEY_RESIZE) {
+            resize_redraw(password_win);
+            refresh();
+            place();
+        }
+        if ((choice == 'j' || choice == KEY_DOWN) && selected + 1 < static_cast<int>(versions.size())) selected++;
+        if ((choice == 'k' || choice == KEY_UP) && selected > 0) selected--;
+        if (choice == 'd') revealed = !revealed;
+        if (choice == 'r' && !versions.empty()) {
+            COMMAND_LOG.run(j, GROUP_TREE, password_command(j, key, versions[selected].value), CYPHER_KEY);
+            restored = true;
+            break;
+        }
+    }
+
+    delwin(history_win);
+
+    return restored;
+}
+
+
+/*
+ * Shows the highlighted entry's fields, copying or editing them on request
+ */
+void
+PassCurses::show_entry(JSON &j, WINDOW *password_win, int highlight, const int &CYPHER_KEY) {
+    const auto key = key_at_highlight(j, highlight);
+    if (key.empty()) return;
+
+    WINDOW *entry_win = nullptr;
+    int rows = 0, columns = 0;
+    // Covers the password box, so it follows the box when the terminal is resized
+    const auto place = [&]() {
+        if (entry_win) delwin(entry_win);
+        getmaxyx(password_win, rows, columns);
+        int start_y, start_x;
+        getbegyx(password_win, start_y, start_x);
+        entry_win = newwin(rows, columns, start_y, start_x);
+        wbkgd(entry_win, COLOR_PAIR(1));
+    };
+    place();
+
+    // Fields are read from their columns now, the list never touches them
+    std::array<std::string, 4> values;
+    for (auto field : ALL_FIELDS) values[static_cast<std::size_t>(field)] = read_field(field, key, CYPHER_KEY);
+    const auto &seed = values[static_cast<std::size_t>(Field::TotpSeed)];
+
+    // Wake up every second so the TOTP countdown keeps moving
+    timeout(1000);
+    auto status = std::string();
+    for (;;) {
+        wclear(entry_win);
+        box(entry_win, 0, 0);
+        mvwprintw(entry_win, 0, 2, "ENTRY: %s", decrypt(key, CYPHER_KEY).c_str());
+        auto line = 1;
+        for (auto field : {Field::Username, Field::Url, Field::Notes}) {
+            mvwprintw(entry_win, line++, 2, "%s: ", field_name(field));
+            waddnstr(entry_win, values[static_cast<std::size_t>(field)].c_str(), columns - 4 - 2 - std::strlen(field_name(field)));
+        }
+        if (!seed.empty()) {
+            const auto now  = std::time(nullptr);
+            const auto code = totp_code(seed, now);
+            mvwprintw(entry_win, line++, 2, "totp: %s (%lds)", code.empty() ? "bad seed" : code.c_str(),
+                      static_cast<long>(TOTP_PERIOD - now % TOTP_PERIOD));
+        }
+        if (!status.empty()) mvwprintw(entry_win, rows - 2, 2, "%s", status.c_str());
+        mvwprintw(entry_win, rows - 1, 2, "%s", "p/u/l/n/t:copy U/L/N/S:set");
+        wrefresh(entry_win);
+
+        const auto choice = getch();
+        if (choice == ERR) continue;
+        if (choice == 'q' || choice == 'i') break;
+        if (choice == KEY_RESIZE) {
+            resize_redraw(password_win);
+            refresh();
+            place();
+            timeout(1000);  // resize_redraw leaves input blocking
+            continue;
+        }
+        status.clear();
+
+        // Copy the password or a field
+        const auto copy_field = [&](Field field, const char *name) {
+            if (copy_field_to_clipboard(key, field, CYPHER_KEY)) status = std::string(name) + " copied!";
+        };
+        if (choice == 'p') {
+            USAGE_INDEX.touch(key);
+            copy_to_clipboard(decrypt(j[key].get<std::string>(), CYPHER_KEY));
+            status = "password copied!";
+        }
+        if (choice == 'u') copy_field(Field::Username, "username");
+        if (choice == 'l') copy_field(Field::Url, "url");
+        if (choice == 'n') copy_field(Field::Notes, "notes");
+        if (choice == 't') copy_field(Field::TotpSeed, "code");
+
+        // Set a field, an empty answer clears it
+        auto field = Field::Username;
+        if (choice == 'U') field = Field::Username;
+        else if (choice == 'L') field = Field::Url;
+        else if (choice == 'N') field = Field::Notes;
+        else if (choice == 'S') field = Field::TotpSeed;
+        else continue;
+
+        char value_chars[256];
+        timeout(-1);
+        curs_set(1);
+        echo();
+        wmove(entry_win, rows - 2, 1);
+        wclrtoeol(entry_win);
+        mvwprintw(entry_win, rows - 2, 2, "%s: ", field_name(field));
+        wgetnstr(entry_win, value_chars, sizeof value_chars - 1);
+        noecho();
+        curs_set(0);
+        timeout(1000);
+
+        std::string value(value_chars), unused;
+        if (field == Field::TotpSeed && !value.empty() && !base32_decode(value, unused)) {
+            status = "not a base32 seed!";
+            continue;
+        }
+        COMMAND_LOG.run(j, GROUP_TREE, field_command(key, field, value.empty() ? "" : encrypt(value, CYPHER_KEY)), CYPHER_KEY);
+        values[static_cast<std::size_t>(field)] = value;
+    }
+    timeout(-1);
+
+    delwin(entry_win);
+}
+
+
+/*
+ * Prompts for another vault and switches to it, unlocking it unless it is still cached
+ */
+bool
+PassCurses::switch_vault(JSON &j, int &CYPHER_KEY, VaultCache &cache) {
+    const auto ROWS = LAYOUT.prompt_row;
+    const auto COLS = LAYOUT.prompt_col;
+
+    std::string names;
+    for (auto &name : list_vaults()) names += (names.empty() ? "" : " ") + name;
+
+    char vault_chars[30];
+    curs_set(1);
+    echo();
+    mvprintw(ROWS-1, COLS, "Vaults: %s", names.c_str());
+    mvprintw(ROWS, COLS, "%s", "Switch to vault: ");
+    getnstr(vault_chars, sizeof vault_chars - 1);
+    noecho();
+    move(ROWS-1, COLS);
+    clrtoeol();
+    move(ROWS, COLS);
+    clrtoeol();
+    const std::string name(vault_chars);
+
+    if (name.empty() || name == VAULT_NAME) {
+        curs_set(0);
+        return false;
+    }
+    // Checked before building a path from it, '..' or a '/' would leave ~/.passcurses/vaults
+    if (!valid_vault_name(name) || !fs::exists(vault_directory_for(name) + "/testing.json")) {
+        mvprintw(ROWS, COLS, "'%s' %s", name.c_str(), "vault not found!");
+        getch();
+        move(ROWS, COLS);
+        clrtoeol();
+        curs_set(0);
+        return false;
+    }
+
+    // Keep the current vault unlocked in memory before leaving it
+    const auto previous = VAULT_NAME;
+    const auto previous_key = CYPHER_KEY;
+    USAGE_INDEX.save(usage_file_path(), CYPHER_KEY);
+    GROUP_TREE.save(groups_file_path());
+    compact_vault(j, CYPHER_KEY);
+    WARM_CACHE_BUILDER.wait();
+    save_warm_cache(j, USAGE_INDEX, CYPHER_KEY);
+    cache.store(previous, CYPHER_KEY, j);
+
+    auto unlocked_key = 0;
+    auto warm_start   = false;
+    auto cold_start   = false;
+    JSON unlocked;
+    UsageIndex usage;
+    if (!cache.take(name, unlocked_key, unlocked)) {
+        select_vault(name);
+
+        char key_chars[30], password_chars[30];
+        mvprintw(ROWS, COLS, "%s", "Enter your KEY: ");
+        getnstr(key_chars, sizeof key_chars - 1);
+        move(ROWS, COLS);
+        clrtoeol();
+        mvprintw(ROWS, COLS, "%s", "Enter master password: ");
+        getnstr(password_chars, sizeof password_chars - 1);
+        move(ROWS, COLS);
+        clrtoeol();
+
+        const std::string key_text(key_chars);
+        const auto digits = !key_text.empty() && key_text.size() < 10 &&
+                            std::all_of(key_text.begin(), key_text.end(), [](unsigned char ch) { return std::isdigit(ch); });
+        if (!digits || read_master_password(std::stoi(key_text)) != password_chars) {
+            // Wrong credentials, go back to where we were
+            select_vault(previous);
+            cache.take(previous, CYPHER_KEY, j);
+            CYPHER_KEY = previous_key;
+            mvprintw(ROWS, COLS, "%s", "Wrong key or password!");
+            getch();
+            move(ROWS, COLS);
+            clrtoeol();
+            curs_set(0);
+            return false;
+        }
+        unlocked_key = std::stoi(key_text);
+        usage.load(usage_file_path(), unlocked_key);
+        warm_start = load_warm_cache(unlocked_key, unlocked, usage);
+        if (!warm_start) {
+            cold_start = true;
+            std::ifstream instream(vault_file_path(), std::ios::binary);
+            unlocked = read_vault(instream, unlocked_key);
+            instream.close();
+        }
     }
 
-    return highlight;
+    select_vault(name);
+    j          = std::move(unlocked);
+    CYPHER_KEY = unlocked_key;
+
+    if (!warm_start) usage.load(usage_file_path(), CYPHER_KEY);
+    USAGE_INDEX = std::move(usage);
+    USAGE_INDEX.sync(j);  // Nothing left to do after a warm start
+    if (cold_start) WARM_CACHE_BUILDER.start(j, USAGE_INDEX, CYPHER_KEY);
+    GROUP_TREE.load(groups_file_path());
+    GROUP_TREE.sync(j);
+    FIELD_STORE.reset();
+    BREACH_CHECKER.clear();
+    COMMAND_LOG.clear();  // Its commands name entries of the vault we left
+    curs_set(0);
 
+    return true;
 }
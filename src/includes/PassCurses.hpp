@@ -1,46 +1,52 @@
 #pragma once // Only include this header once, in lieu of header guards
-#include <filesystem>
-#include <iostream>
 #include <ncurses.h>
 #include <termios.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <pwd.h>
-#include <fstream>
-#include <unistd.h>
-#include <iomanip>
-#include <random>
 #include <thread>
 #include <tuple>
-#include "json.hpp"
-
-
-extern const int WIDTH;
-extern const int HEIGHT;
-extern const int BOX_SPACE;
+#include "Core.hpp"
 
 
 namespace PassCurses {
 
     /*
-     * Encrypts messages with XOR encryption
+     * Where everything goes for the current terminal size
      */
-    inline std::string
-    encrypt(std::string message, const int &CYPHER_KEY);
+    struct Layout {
+        int height = 0, width = 0;          // Password box, border included
+        int start_y = 0, start_x = 0;
+        int box_space = 0;                  // Entries shown per page
+        int prompt_row = 0, prompt_col = 0; // Prompts, two-line ones also use the row above
+        int help_row = 0;
+    };
+}
 
 
+extern const int LAYOUT_MIN_WIDTH;
+extern const int LAYOUT_MAX_WIDTH;
+extern const int RESIZE_SETTLE_MS;
+extern PassCurses::UsageIndex USAGE_INDEX;
+extern PassCurses::BreachIndex BREACH_INDEX;
+extern PassCurses::BreachChecker BREACH_CHECKER;
+extern PassCurses::GroupTree GROUP_TREE;
+extern PassCurses::Layout LAYOUT;
+extern PassCurses::WarmCacheBuilder WARM_CACHE_BUILDER;
+extern PassCurses::CommandLog COMMAND_LOG;
+
+
+namespace PassCurses {
+
     /*
-     * Decrypts XOR-encrypted messages
+     * Places the password box for the current terminal size
      */
-    inline std::string
-    decrypt(std::string message, const int &CYPHER_KEY);
+    Layout
+    compute_layout();
 
 
     /*
-     * Respond to window resize by redrawing
+     * Respond to window resize by laying out the password window again, once per burst of resizes
      */
-    inline std::tuple<const int, const int>
-    resize_redraw();
+    void
+    resize_redraw(WINDOW *password_win);
 
 
     /*
@@ -49,32 +55,21 @@ namespace PassCurses {
     void
     create_rc(const int &CYPHER_KEY);
 
-    inline std::string
-    get_home_directory();
-
-
     /*
      * Creates directory for data files
      */
-    inline void
+    void
     create_data_directory(const std::string &home_directory);
 
 
-    inline void
+    void
     initialize_ncurses();
 
 
-    inline WINDOW*
+    WINDOW*
     initialize_ncurses_window();
 
 
-    /*
-     * Getting master password from user, comparing to file
-     */
-    std::string
-    read_master_password(const int &CYPHER_KEY);
-
-
     /*
      * Getting the cypher key from the user
      */
@@ -97,10 +92,10 @@ namespace PassCurses {
 
 
     /*
-     * Writes edited nlohmann::json to file
+     * Reads a password file in either the plain or the compressed format, exiting if it is corrupt
      */
-    void
-    write_to_file(nlohmann::json &j);
+    nlohmann::json
+    read_vault(std::istream &instream, const int &CYPHER_KEY);
 
 
     /*
@@ -118,7 +113,7 @@ namespace PassCurses {
 
 
     /*
-     * Generates a random password
+     * Prompts for a length and generates a random password of it
      */
     std::string
     generate_password(WINDOW *password_win);
@@ -137,18 +132,123 @@ namespace PassCurses {
     open_password_file(const int &CYPHER_KEY);
 
     void
-    inline copy_password_to_clipboard(nlohmann::json &j, const int &highlight, const int &CYPHER_KEY);
+    copy_password_to_clipboard(nlohmann::json &j, const int &highlight, const int &CYPHER_KEY);
+
+    /*
+     * Puts text on the clipboard without passing it through a shell
+     */
+    void
+    copy_to_clipboard(const std::string &text);
 
+    /*
+     * Copy one field of the highlighted entry to clipboard, the current code for a TOTP seed
+     */
     bool
-    inline print_help_message(bool help_printed);
+    copy_field_to_clipboard(nlohmann::json &j, int highlight, Field field, const int &CYPHER_KEY);
+
+    /*
+     * Copy one field of an entry given by its encrypted key, the current code for a TOTP seed
+     */
+    bool
+    copy_field_to_clipboard(const std::string &key, Field field, const int &CYPHER_KEY);
+
+    /*
+     * Shows the highlighted entry's fields, copying or editing them on request
+     */
+    void
+    show_entry(nlohmann::json &j, WINDOW *password_win, int highlight, const int &CYPHER_KEY);
+
+    void
+    print_help_message(WINDOW *password_win);
 
 
     /*
-     * Delete a password entry in the JSON file
+     * Delete a password entry in the JSON file, 'u' brings it back
      */
     bool
     delete_password_entry(nlohmann::json &j, int highlight, const int &CYPHER_KEY);
 
+    /*
+     * Undoes the last change, or redoes the last undone one, and follows the entry it touched.
+     * Returns what was done, for the prompt line
+     */
+    std::string
+    undo_last_change(nlohmann::json &j, int &highlight, const int &CYPHER_KEY, bool redo);
+
+    /*
+     * Encrypted key of the entry shown at a highlight position, empty if there is none
+     */
+    std::string
+    key_at_highlight(nlohmann::json &j, int highlight);
+
+
+    /*
+     * Encrypted keys of up to count rows in display order, starting from first; group headers give empty keys
+     */
+    std::vector<std::string>
+    keys_in_view(nlohmann::json &j, int first, int count);
+
+
+    /*
+     * Up to count rows in display order, starting from first
+     */
+    std::vector<GroupTree::Row>
+    rows_in_view(nlohmann::json &j, int first, int count);
+
+
+    /*
+     * Number of rows the active view shows
+     */
+    std::size_t
+    view_size(nlohmann::json &j);
+
+
+    /*
+     * Whether the group tree or a tag filter decides what is shown
+     */
+    bool
+    tree_view_active();
+
+
+    /*
+     * Prompts for the highlighted entry's group path and tags
+     */
+    void
+    edit_groups(nlohmann::json &j, int highlight, const int &CYPHER_KEY);
+
+
+    /*
+     * Prompts for a tag and shows only the entries carrying it, an empty tag clears the filter
+     */
+    void
+    filter_by_tag(const int &CYPHER_KEY);
+
+
+    /*
+     * Display position of an entry, in whichever order is active
+     */
+    std::size_t
+    position_of(nlohmann::json &j, const std::string &key);
+
+
+    /*
+     * Shows previous versions of the highlighted entry and restores one if chosen
+     */
+    bool
+    show_history(nlohmann::json &j, WINDOW *password_win, int highlight, const int &CYPHER_KEY);
+
+    /*
+     * Shows lines of text in a scrollable window over the password box
+     */
+    void
+    show_report(WINDOW *password_win, const std::string &title, const std::vector<std::string> &lines);
+
+    /*
+     * Prompts for another vault and switches to it, unlocking it unless it is still cached
+     */
+    bool
+    switch_vault(nlohmann::json &j, int &CYPHER_KEY, VaultCache &cache);
+
     /*
      * Search for a password entry
      */
@@ -0,0 +1,200 @@
+#include "Usage.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+using JSON = nlohmann::json;
+
+const double PassCurses::FRECENCY_HALF_LIFE_DAYS = 14.0;
+
+namespace {
+
+    const double DECAY_RATE = std::log(2.0) / (PassCurses::FRECENCY_HALF_LIFE_DAYS * 24 * 60 * 60);
+    const double NEVER_USED = -std::numeric_limits<double>::infinity();
+
+
+    /*
+     * log(exp(a) + exp(b)) without overflowing
+     */
+    inline double
+    log_add(double a, double b) {
+        if (a == NEVER_USED) return b;
+        const auto high = std::max(a, b);
+        const auto low  = std::min(a, b);
+
+        return high + std::log1p(std::exp(low - high));
+    }
+}
+
+
+/*
+ * Reads encrypted usage statistics, missing or unreadable files start empty
+ */
+void
+PassCurses::UsageIndex::load(const std::string &path, const int &CYPHER_KEY) {
+    stats_.clear();
+    std::ifstream instream(path, std::ios::binary);
+    if (!instream.is_open()) return;
+
+    const std::string data((std::istreambuf_iterator<char>(instream)), std::istreambuf_iterator<char>());
+    instream.close();
+
+    auto usage = JSON::parse(decrypt(data, CYPHER_KEY), nullptr, false);
+    if (usage.is_discarded() || !usage.is_object()) return;
+
+    enabled = usage.value("order", false);
+    for (auto& [key, value] : usage["entries"].items()) {
+        stats_[key] = {value["s"].get<double>(),
+                       value["n"].get<std::uint32_t>(),
+                       static_cast<std::time_t>(value["t"].get<long long>())};
+    }
+}
+
+
+/*
+ * Writes usage statistics encrypted with the vault cipher
+ */
+void
+PassCurses::UsageIndex::save(const std::string &path, const int &CYPHER_KEY) const {
+    JSON usage;
+    usage["order"]   = enabled;
+    usage["entries"] = JSON::object();
+    for (auto& [key, stats] : stats_) {
+        usage["entries"][key] = {{"s", stats.score}, {"n", stats.count}, {"t", static_cast<long long>(stats.last_used)}};
+    }
+
+    std::ofstream outstream(path, std::ios::binary);
+    if (!outstream.is_open()) {
+        std::cerr << "CAN'T WRITE TO USAGE FILE!" << std::endl;
+        return;
+    }
+    outstream << encrypt(usage.dump(), CYPHER_KEY);
+    outstream.close();
+}
+
+
+/*
+ * Brings the order in line with the vault's keys after entries were added or removed
+ */
+void
+PassCurses::UsageIndex::sync(const JSON &j) {
+    // Forget entries that left the vault
+    order_.erase(std::remove_if(order_.begin(), order_.end(),
+                                [&](const std::string &key) { return !j.contains(key); }),
+                 order_.end());
+    for (auto it = stats_.begin(); it != stats_.end();) {
+        if (!j.contains(it->first)) it = stats_.erase(it);
+        else ++it;
+    }
+
+    // Sort only the newcomers and merge them in, the rest of the order is already sorted
+    if (order_.size() == j.size()) return;
+    const auto comparator = [this](const std::string &a, const std::string &b) { return before(a, b); };
+    const std::unordered_set<std::string> known(order_.begin(), order_.end());
+    const auto middle = order_.size();
+    for (auto& [key, value] : j.items()) {
+        if (!known.count(key)) order_.push_back(key);
+    }
+    std::sort(order_.begin() + middle, order_.end(), comparator);
+    std::inplace_merge(order_.begin(), order_.begin() + middle, order_.end(), comparator);
+}
+
+
+/*
+ * Puts a new entry in its place in the order, with the counters it had if it is being
+ * brought back; an entry already there stays put
+ */
+void
+PassCurses::UsageIndex::insert(const std::string &key, const Stats &stats) {
+    const auto comparator = [this](const std::string &a, const std::string &b) { return before(a, b); };
+    auto slot = std::lower_bound(order_.begin(), order_.end(), key, comparator);
+    if (slot != order_.end() && *slot == key) return;
+
+    if (stats.count > 0) {
+        stats_[key] = stats;
+        slot = std::lower_bound(order_.begin(), order_.end(), key, comparator);
+    }
+    order_.insert(slot, key);
+}
+
+
+/*
+ * Drops a deleted entry from the order along with its statistics
+ */
+void
+PassCurses::UsageIndex::erase(const std::string &key) {
+    // Find it while its score still places it
+    auto slot = std::lower_bound(order_.begin(), order_.end(), key,
+                                 [this](const std::string &a, const std::string &b) { return before(a, b); });
+    if (slot != order_.end() && *slot == key) order_.erase(slot);
+    stats_.erase(key);
+}
+
+
+/*
+ * Records a copy or reveal of an entry, moving it forward in the order
+ */
+void
+PassCurses::UsageIndex::touch(const std::string &key) {
+    const auto comparator = [this](const std::string &a, const std::string &b) { return before(a, b); };
+    auto current = std::lower_bound(order_.begin(), order_.end(), key, comparator);
+
+    auto &stats = stats_.try_emplace(key, Stats{NEVER_USED, 0, 0}).first->second;
+    const auto now = std::time(nullptr);
+    stats.score     = log_add(stats.score, DECAY_RATE * static_cast<double>(now));
+    stats.count    += 1;
+    stats.last_used = now;
+
+    if (current == order_.end() || *current != key) return;
+
+    // Only entries ahead of this one can be overtaken, so rotate it into its new slot
+    auto slot = std::lower_bound(order_.begin(), current, key, comparator);
+    std::rotate(slot, current, current + 1);
+}
+
+
+double
+PassCurses::UsageIndex::score(const std::string &key) const {
+    auto it = stats_.find(key);
+
+    return it == stats_.end() ? NEVER_USED : it->second.score;
+}
+
+
+PassCurses::UsageIndex::Stats
+PassCurses::UsageIndex::stats_of(const std::string &key) const {
+    auto it = stats_.find(key);
+
+    return it == stats_.end() ? Stats() : it->second;
+}
+
+
+std::uint32_t
+PassCurses::UsageIndex::use_count(const std::string &key) const {
+    auto it = stats_.find(key);
+
+    return it == stats_.end() ? 0 : it->second.count;
+}
+
+
+/*
+ * Position of an entry in the frecency order
+ */
+std::size_t
+PassCurses::UsageIndex::position(const std::string &key) const {
+    auto it = std::lower_bound(order_.begin(), order_.end(), key,
+                               [this](const std::string &a, const std::string &b) { return before(a, b); });
+
+    return std::distance(order_.begin(), it);
+}
+
+
+bool
+PassCurses::UsageIndex::before(const std::string &a, const std::string &b) const {
+    const auto score_a = score(a), score_b = score(b);
+    if (score_a != score_b) return score_a > score_b;
+
+    return a < b;
+}
@@ -0,0 +1,115 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "json.hpp"
+
+
+namespace PassCurses {
+
+    extern const double FRECENCY_HALF_LIFE_DAYS;
+
+
+    /*
+     * Per-entry usage counters and the frecency display order built from them.
+     *
+     * Scores are kept as log(sum(exp(rate * time_of_use))), which decays every entry
+     * at the same speed, so the relative order never changes with the passage of time.
+     * A use only raises one score, and that entry is moved forward in place.
+     */
+    class UsageIndex {
+    public:
+        /*
+         * Counters of one entry; a zero count means it was never used
+         */
+        struct Stats {
+            double        score;
+            std::uint32_t count;
+            std::time_t   last_used;
+        };
+
+
+        /*
+         * Reads encrypted usage statistics, missing or unreadable files start empty
+         */
+        void
+        load(const std::string &path, const int &CYPHER_KEY);
+
+
+        /*
+         * Writes usage statistics encrypted with the vault cipher
+         */
+        void
+        save(const std::string &path, const int &CYPHER_KEY) const;
+
+
+        /*
+         * Brings the order in line with the vault's keys after entries were added or removed
+         */
+        void
+        sync(const nlohmann::json &j);
+
+
+        /*
+         * Puts a new entry in its place in the order, with the counters it had if it is being
+         * brought back; an entry already there stays put
+         */
+        void
+        insert(const std::string &key, const Stats &stats = {});
+
+
+        /*
+         * Drops a deleted entry from the order along with its statistics
+         */
+        void
+        erase(const std::string &key);
+
+
+        /*
+         * Records a copy or reveal of an entry, moving it forward in the order
+         */
+        void
+        touch(const std::string &key);
+
+
+        double
+        score(const std::string &key) const;
+
+
+        Stats
+        stats_of(const std::string &key) const;
+
+
+        std::uint32_t
+        use_count(const std::string &key) const;
+
+
+        /*
+         * Position of an entry in the frecency order
+         */
+        std::size_t
+        position(const std::string &key) const;
+
+
+        const std::vector<std::string> &
+        order() const { return order_; }
+
+
+        /*
+         * Takes an order known to be what sync would build, e.g. from the warm-start cache
+         */
+        void
+        adopt_order(std::vector<std::string> order) { order_ = std::move(order); }
+
+
+        bool enabled = false;  // Whether the frecency order is the display order
+
+    private:
+        bool
+        before(const std::string &a, const std::string &b) const;
+
+        std::unordered_map<std::string, Stats> stats_;
+        std::vector<std::string>               order_;  // Hottest first, unused entries in key order
+    };
+}
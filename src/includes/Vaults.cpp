@@ -0,0 +1,180 @@
+#include "Vaults.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+using JSON = nlohmann::json;
+
+const std::string PassCurses::DEFAULT_VAULT    = "default";
+const std::size_t PassCurses::VAULT_CACHE_SIZE = 4;
+
+std::string PassCurses::VAULT_NAME      = DEFAULT_VAULT;
+// Not from HOME_DIRECTORY, which lives in another translation unit and may not be initialised yet
+std::string PassCurses::VAULT_DIRECTORY = PassCurses::get_home_directory() + "/.passcurses";
+
+namespace {
+
+    inline void
+    append_span(char *&out, const std::string &text) {
+        const auto length = static_cast<std::uint32_t>(text.size());
+        std::memcpy(out, &length, sizeof length);
+        std::memcpy(out + sizeof length, text.data(), length);
+        out += sizeof length + length;
+    }
+
+
+    inline std::string
+    read_span(const char *&in) {
+        std::uint32_t length;
+        std::memcpy(&length, in, sizeof length);
+        std::string text(in + sizeof length, length);
+        in += sizeof length + length;
+
+        return text;
+    }
+}
+
+
+/*
+ * Directory holding a vault's files; the default vault lives directly in ~/.passcurses
+ */
+std::string
+PassCurses::vault_directory_for(const std::string &name) {
+    if (name == DEFAULT_VAULT) return HOME_DIRECTORY + "/.passcurses";
+
+    return HOME_DIRECTORY + "/.passcurses/vaults/" + name;
+}
+
+
+/*
+ * Whether a name can be a vault, i.e. names a directory directly under ~/.passcurses/vaults
+ */
+bool
+PassCurses::valid_vault_name(const std::string &name) {
+    return !name.empty() && name != "." && name != ".." && name.find('/') == std::string::npos;
+}
+
+
+/*
+ * Makes the named vault the one all vault files are read from and written to
+ */
+void
+PassCurses::select_vault(const std::string &name) {
+    VAULT_NAME      = name;
+    VAULT_DIRECTORY = vault_directory_for(name);
+}
+
+
+std::string
+PassCurses::vault_file_path() {
+    return VAULT_DIRECTORY + "/testing.json";
+}
+
+
+std::string
+PassCurses::passrc_path() {
+    return VAULT_DIRECTORY + "/passrc";
+}
+
+
+/*
+ * Names of all vaults that have a password file
+ */
+std::vector<std::string>
+PassCurses::list_vaults() {
+    std::vector<std::string> names;
+    if (fs::exists(vault_directory_for(DEFAULT_VAULT) + "/testing.json")) names.push_back(DEFAULT_VAULT);
+
+    std::error_code ec;
+    for (auto &entry : fs::directory_iterator(HOME_DIRECTORY + "/.passcurses/vaults", ec)) {
+        if (fs::exists(entry.path() / "testing.json")) names.push_back(entry.path().filename().string());
+    }
+    std::sort(names.begin() + (names.empty() || names.front() != DEFAULT_VAULT ? 0 : 1), names.end());
+
+    return names;
+}
+
+
+PassCurses::LockedBuffer::LockedBuffer(std::size_t size) : size_(size) {
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    capacity_ = std::max(page, (size + page - 1) / page * page);
+
+    void *mapped = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) throw std::bad_alloc();
+    data_ = static_cast<char *>(mapped);
+
+    // Locking can fail under a low RLIMIT_MEMLOCK, the buffer is still wiped on release
+    mlock(data_, capacity_);
+    madvise(data_, capacity_, MADV_DONTDUMP);
+}
+
+
+PassCurses::LockedBuffer::LockedBuffer(LockedBuffer &&other) noexcept
+    : data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+    other.data_ = nullptr;
+    other.size_ = other.capacity_ = 0;
+}
+
+
+PassCurses::LockedBuffer::~LockedBuffer() {
+    if (!data_) return;
+    explicit_bzero(data_, capacity_);
+    munlock(data_, capacity_);
+    munmap(data_, capacity_);
+}
+
+
+/*
+ * Packs a vault into the cache as most recently used, evicting the oldest past VAULT_CACHE_SIZE
+ */
+void
+PassCurses::VaultCache::store(const std::string &name, int cypher_key, const JSON &j) {
+    for (auto it = vaults_.begin(); it != vaults_.end(); ++it) {
+        if (it->name == name) {
+            vaults_.erase(it);
+            break;
+        }
+    }
+
+    std::size_t size = 0;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        size += 2 * sizeof(std::uint32_t) + it.key().size() + it.value().get_ref<const std::string &>().size();
+    }
+
+    LockedBuffer entries(size);
+    auto *out = entries.data();
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        append_span(out, it.key());
+        append_span(out, it.value().get_ref<const std::string &>());
+    }
+
+    vaults_.push_front({name, cypher_key, j.size(), std::move(entries)});
+    while (vaults_.size() > VAULT_CACHE_SIZE) vaults_.pop_back();  // LockedBuffer wipes itself
+}
+
+
+/*
+ * Unpacks a cached vault and removes it from the cache, false if it isn't cached
+ */
+bool
+PassCurses::VaultCache::take(const std::string &name, int &cypher_key, JSON &j) {
+    for (auto it = vaults_.begin(); it != vaults_.end(); ++it) {
+        if (it->name != name) continue;
+
+        // Entries were packed in key order, so every insert lands at the end of the map
+        j = JSON::object();
+        auto &object = j.get_ref<JSON::object_t &>();
+        const char *in = it->entries.data();
+        for (std::size_t i = 0; i < it->entry_count; i++) {
+            auto key = read_span(in);
+            object.emplace_hint(object.end(), std::move(key), read_span(in));
+        }
+        cypher_key = it->cypher_key;
+        vaults_.erase(it);
+
+        return true;
+    }
+
+    return false;
+}
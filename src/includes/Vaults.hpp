@@ -0,0 +1,118 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+
+namespace PassCurses {
+
+    extern const std::string DEFAULT_VAULT;
+    extern const std::size_t VAULT_CACHE_SIZE;
+    extern std::string VAULT_NAME;
+    extern std::string VAULT_DIRECTORY;
+
+
+    /*
+     * Directory holding a vault's files; the default vault lives directly in ~/.passcurses
+     */
+    std::string
+    vault_directory_for(const std::string &name);
+
+
+    /*
+     * Whether a name can be a vault, i.e. names a directory directly under ~/.passcurses/vaults
+     */
+    bool
+    valid_vault_name(const std::string &name);
+
+
+    /*
+     * Makes the named vault the one all vault files are read from and written to
+     */
+    void
+    select_vault(const std::string &name);
+
+
+    std::string
+    vault_file_path();
+
+
+    std::string
+    passrc_path();
+
+
+    /*
+     * Names of all vaults that have a password file
+     */
+    std::vector<std::string>
+    list_vaults();
+
+
+    /*
+     * Page-aligned buffer that is kept out of swap and core dumps, and zeroed before release
+     */
+    class LockedBuffer {
+    public:
+        explicit LockedBuffer(std::size_t size);
+        LockedBuffer(LockedBuffer &&other) noexcept;
+        LockedBuffer(const LockedBuffer &) = delete;
+        LockedBuffer &operator=(const LockedBuffer &) = delete;
+        LockedBuffer &operator=(LockedBuffer &&) = delete;
+        ~LockedBuffer();
+
+        char *
+        data() { return data_; }
+
+        const char *
+        data() const { return data_; }
+
+        std::size_t
+        size() const { return size_; }
+
+    private:
+        char        *data_     = nullptr;
+        std::size_t  size_     = 0;
+        std::size_t  capacity_ = 0;  // Mapped length, rounded up to whole pages
+    };
+
+
+    /*
+     * A vault that was unlocked earlier in the session, packed into locked memory
+     */
+    struct UnlockedVault {
+        std::string  name;
+        int          cypher_key;
+        std::size_t  entry_count;
+        LockedBuffer entries;  // Length-prefixed key/value pairs in key order
+    };
+
+
+    /*
+     * Least recently used cache of unlocked vaults, so switching back needs neither the
+     * master password nor reading the file again. Evicted vaults are wiped
+     */
+    class VaultCache {
+    public:
+        /*
+         * Packs a vault into the cache as most recently used, evicting the oldest past VAULT_CACHE_SIZE
+         */
+        void
+        store(const std::string &name, int cypher_key, const nlohmann::json &j);
+
+
+        /*
+         * Unpacks a cached vault and removes it from the cache, false if it isn't cached
+         */
+        bool
+        take(const std::string &name, int &cypher_key, nlohmann::json &j);
+
+
+        std::size_t
+        size() const { return vaults_.size(); }
+
+    private:
+        std::list<UnlockedVault> vaults_;  // Most recently used first
+    };
+}
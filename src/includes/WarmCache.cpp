@@ -0,0 +1,250 @@
+#include "WarmCache.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using JSON = nlohmann::json;
+
+const std::uint32_t PassCurses::WARM_CACHE_VERSION = 2;
+
+namespace {
+
+    const char          WARM_MAGIC[4]  = {'P', 'C', 'W', '1'};
+    const std::size_t   HEADER_SIZE    = 48;
+    const std::uint64_t HASH_K1        = 0x7761726d2d636163ULL;
+    const std::uint32_t FLAG_COMPRESSED = 1;
+
+
+    /*
+     * Read-only mapping of a whole file, empty if it is missing or empty
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &path) {
+            const auto fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED) {
+                    data_ = static_cast<const char *>(data);
+                    size_ = static_cast<std::size_t>(info.st_size);
+                }
+            }
+            close(fd);
+        }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile() { if (data_) munmap(const_cast<char *>(data_), size_); }
+
+        std::string_view
+        view() const { return {data_, size_}; }
+
+    private:
+        const char  *data_ = nullptr;
+        std::size_t  size_ = 0;
+    };
+
+
+    /*
+     * Content hash of a file, keyed by the vault key so a cache never matches under another key
+     */
+    std::uint64_t
+    file_hash(const std::string &path, const int &CYPHER_KEY) {
+        const MappedFile file(path);
+
+        return PassCurses::siphash(file.view(), 0x5043575f6b657930ULL ^ static_cast<std::uint64_t>(CYPHER_KEY), HASH_K1);
+    }
+
+
+    template <typename T>
+    void
+    append(std::string &out, T v) {
+        out.append(reinterpret_cast<const char *>(&v), sizeof v);
+    }
+
+
+    template <typename T>
+    bool
+    take(std::string_view &in, T &v) {
+        if (in.size() < sizeof v) return false;
+        std::memcpy(&v, in.data(), sizeof v);
+        in.remove_prefix(sizeof v);
+
+        return true;
+    }
+
+
+    bool
+    take_span(std::string_view &in, std::string_view &span) {
+        std::uint32_t length;
+        if (!take(in, length) || in.size() < length) return false;
+        span = in.substr(0, length);
+        in.remove_prefix(length);
+
+        return true;
+    }
+
+
+    /*
+     * Entries in key order, as stored in the vault, then the frecency order as encrypted ordinals
+     */
+    std::string
+    serialize(const JSON &j, const PassCurses::UsageIndex &usage, const int &CYPHER_KEY) {
+        std::string payload;
+        std::vector<const std::string *> keys;
+        keys.reserve(j.size());
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            const auto &value = it.value().get_ref<const std::string &>();
+            append(payload, static_cast<std::uint32_t>(it.key().size()));
+            payload += it.key();
+            append(payload, static_cast<std::uint32_t>(value.size()));
+            payload += value;
+            keys.push_back(&it.key());
+        }
+
+        // Keys come out of the vault sorted, so an entry's ordinal is a binary search away
+        std::string ordinals;
+        ordinals.reserve(usage.order().size() * sizeof(std::uint32_t));
+        for (auto &key : usage.order()) {
+            auto slot = std::lower_bound(keys.begin(), keys.end(), key,
+                                         [](const std::string *a, const std::string &b) { return *a < b; });
+            append(ordinals, static_cast<std::uint32_t>(slot - keys.begin()));
+        }
+        append(payload, static_cast<std::uint32_t>(usage.order().size()));
+        payload += PassCurses::encrypt(ordinals, CYPHER_KEY);
+
+        return payload;
+    }
+
+
+    void
+    write_cache(const std::string &path, const std::string &payload, std::uint32_t entry_count,
+                std::uint32_t flags, std::uint64_t vault_hash, std::uint64_t journal_hash, std::uint64_t usage_hash) {
+        std::string header(WARM_MAGIC, 4);
+        append(header, PassCurses::WARM_CACHE_VERSION);
+        append(header, flags);
+        append(header, entry_count);
+        append(header, vault_hash);
+        append(header, journal_hash);
+        append(header, usage_hash);
+        append(header, static_cast<std::uint64_t>(payload.size()));
+
+        std::ofstream outstream(path + ".tmp", std::ios::binary);
+        if (!outstream.is_open()) return;  // Only a cache, the next start just runs cold
+        outstream.write(header.data(), header.size());
+        outstream.write(payload.data(), payload.size());
+        outstream.close();
+        if (outstream.fail()) return;
+        fs::rename(path + ".tmp", path);
+    }
+}
+
+
+std::string
+PassCurses::warm_cache_path() {
+    return VAULT_DIRECTORY + "/warm.cache";
+}
+
+
+/*
+ * Fills the vault and the frecency order from the warm-start cache, if it was built from
+ * exactly the vault, journal and usage files on disk now
+ */
+bool
+PassCurses::load_warm_cache(const int &CYPHER_KEY, JSON &j, UsageIndex &usage) {
+    const MappedFile cache(warm_cache_path());
+    auto in = cache.view();
+
+    std::uint32_t version, flags, entry_count, order_count;
+    std::uint64_t vault_hash, journal_hash, usage_hash, payload_size;
+    if (in.size() < HEADER_SIZE || std::memcmp(in.data(), WARM_MAGIC, 4) != 0) return false;
+    in.remove_prefix(4);
+    take(in, version);
+    take(in, flags);
+    take(in, entry_count);
+    take(in, vault_hash);
+    take(in, journal_hash);
+    take(in, usage_hash);
+    take(in, payload_size);
+    if (version != WARM_CACHE_VERSION || payload_size != in.size()) return false;
+
+    // Stale unless the files are byte for byte what the cache was built from
+    if (file_hash(vault_file_path(), CYPHER_KEY) != vault_hash ||
+        file_hash(journal_file_path(), CYPHER_KEY) != journal_hash ||
+        file_hash(usage_file_path(), CYPHER_KEY) != usage_hash) return false;
+
+    JSON entries = JSON::object();
+    auto &object = entries.get_ref<JSON::object_t &>();
+    std::vector<std::string> keys;
+    keys.reserve(entry_count);
+    for (std::uint32_t i = 0; i < entry_count; i++) {
+        std::string_view key, value;
+        if (!take_span(in, key) || !take_span(in, value)) return false;
+        // Written in key order, so every entry goes straight to the end of the map
+        object.emplace_hint(object.end(), std::string(key), JSON(std::string(value)));
+        keys.emplace_back(key);
+    }
+
+    if (!take(in, order_count) || order_count != entry_count || in.size() != order_count * sizeof(std::uint32_t)) return false;
+    const auto ordinals = encrypt(std::string(in), CYPHER_KEY);
+    std::vector<std::string> order;
+    order.reserve(order_count);
+    for (std::uint32_t i = 0; i < order_count; i++) {
+        std::uint32_t ordinal;
+        std::memcpy(&ordinal, ordinals.data() + i * sizeof ordinal, sizeof ordinal);
+        if (ordinal >= keys.size()) return false;
+        order.push_back(keys[ordinal]);
+    }
+
+    j = std::move(entries);
+    usage.adopt_order(std::move(order));
+    COMPRESSED_STORAGE = (flags & FLAG_COMPRESSED) != 0;
+
+    return true;
+}
+
+
+/*
+ * Writes the warm-start cache for the vault and frecency order as they are on disk now
+ */
+void
+PassCurses::save_warm_cache(const JSON &j, const UsageIndex &usage, const int &CYPHER_KEY) {
+    write_cache(warm_cache_path(), serialize(j, usage, CYPHER_KEY), static_cast<std::uint32_t>(j.size()),
+                COMPRESSED_STORAGE ? FLAG_COMPRESSED : 0,
+                file_hash(vault_file_path(), CYPHER_KEY), file_hash(journal_file_path(), CYPHER_KEY),
+                file_hash(usage_file_path(), CYPHER_KEY));
+}
+
+
+/*
+ * Takes a snapshot now and hashes and writes it in the background
+ */
+void
+PassCurses::WarmCacheBuilder::start(const JSON &j, const UsageIndex &usage, const int &CYPHER_KEY) {
+    wait();
+
+    const auto writes      = VAULT_WRITES.load();
+    const auto entry_count = static_cast<std::uint32_t>(j.size());
+    const auto flags       = COMPRESSED_STORAGE ? FLAG_COMPRESSED : 0;
+    // Paths are taken now, switching vaults must not redirect the write
+    worker_ = std::thread([payload = serialize(j, usage, CYPHER_KEY), entry_count, flags, writes, CYPHER_KEY,
+                           cache_path = warm_cache_path(), vault_path = vault_file_path(),
+                           journal_path = journal_file_path(), usage_path = usage_file_path()] {
+        const auto vault_hash   = file_hash(vault_path, CYPHER_KEY);
+        const auto journal_hash = file_hash(journal_path, CYPHER_KEY);
+        const auto usage_hash   = file_hash(usage_path, CYPHER_KEY);
+        // A write since the snapshot means the hashes may not describe it
+        if (VAULT_WRITES.load() != writes) return;
+        write_cache(cache_path, payload, entry_count, flags, vault_hash, journal_hash, usage_hash);
+    });
+}
+
+
+void
+PassCurses::WarmCacheBuilder::wait() {
+    if (worker_.joinable()) worker_.join();
+}
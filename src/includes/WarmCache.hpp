@@ -0,0 +1,60 @@
+#pragma once // Only include this header once, in lieu of header guards
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "json.hpp"
+#include "Usage.hpp"
+
+
+namespace PassCurses {
+
+    extern const std::uint32_t WARM_CACHE_VERSION;
+
+
+    std::string
+    warm_cache_path();
+
+
+    /*
+     * Fills the vault and the frecency order from the warm-start cache, if it was built from
+     * exactly the vault, journal and usage files on disk now. False when it is missing, stale
+     * or from another version, in which case nothing is touched.
+     *
+     * The usage statistics must already be loaded, only their order comes from the cache.
+     */
+    bool
+    load_warm_cache(const int &CYPHER_KEY, nlohmann::json &j, UsageIndex &usage);
+
+
+    /*
+     * Writes the warm-start cache for the vault and frecency order as they are on disk now
+     */
+    void
+    save_warm_cache(const nlohmann::json &j, const UsageIndex &usage, const int &CYPHER_KEY);
+
+
+    /*
+     * Rebuilds the warm-start cache off the UI thread after a cold start
+     */
+    class WarmCacheBuilder {
+    public:
+        WarmCacheBuilder() = default;
+        WarmCacheBuilder(const WarmCacheBuilder &) = delete;
+        WarmCacheBuilder &operator=(const WarmCacheBuilder &) = delete;
+        ~WarmCacheBuilder() { wait(); }
+
+        /*
+         * Takes a snapshot now and hashes and writes it in the background; the snapshot is
+         * dropped if the vault is written again before it has been hashed
+         */
+        void
+        start(const nlohmann::json &j, const UsageIndex &usage, const int &CYPHER_KEY);
+
+
+        void
+        wait();
+
+    private:
+        std::thread worker_;
+    };
+}
@@ -0,0 +1,80 @@
+/*
+ * C interface to libpasscurses, for programs that want to read or update a vault
+ * in-process instead of driving the TUI.
+ *
+ * Strings returned by the library are allocated for the caller and must be released
+ * with pc_free, which zeroes them first. Functions returning int give 0 on success and
+ * -1 on failure. Calls may come from any thread but are serialised, since the library
+ * keeps one current vault directory per process; each call switches to its own vault.
+ * A handle keeps its own copy of the vault, so with the same vault open twice, or open
+ * in the TUI as well, the last one to save wins.
+ */
+#ifndef PASSCURSES_H
+#define PASSCURSES_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pc_vault pc_vault;
+
+/*
+ * Unlocks a vault, NULL or "" for the default one. Returns NULL if the vault doesn't
+ * exist or the key and master password don't match it.
+ */
+pc_vault *pc_open(const char *vault_name, int key, const char *master_password);
+
+/*
+ * Writes the whole vault file if changes were only journaled so far, and frees the vault
+ */
+void pc_close(pc_vault *vault);
+
+/*
+ * Number of entries, and the name of one of them by index
+ */
+size_t pc_count(const pc_vault *vault);
+
+char *pc_name_at(const pc_vault *vault, size_t index);
+
+/*
+ * Password of an entry, NULL if there is no such entry
+ */
+char *pc_get(pc_vault *vault, const char *name);
+
+/*
+ * One field of an entry: "username", "url", "notes" or "totp", which gives the current
+ * code rather than the seed. NULL if the entry has no such field.
+ */
+char *pc_get_field(pc_vault *vault, const char *name, const char *field);
+
+/*
+ * Name of the entry a search finds, as with '/' in the TUI, NULL if nothing matches
+ */
+char *pc_search(pc_vault *vault, const char *text);
+
+/*
+ * Adds or overwrites an entry's password, saving the vault
+ */
+int pc_set(pc_vault *vault, const char *name, const char *password);
+
+/*
+ * Sets one field of an existing entry, an empty value removes it
+ */
+int pc_set_field(pc_vault *vault, const char *name, const char *field, const char *value);
+
+int pc_delete(pc_vault *vault, const char *name);
+
+/*
+ * Random password of letters and digits
+ */
+char *pc_generate(size_t length);
+
+void pc_free(char *text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
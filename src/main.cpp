@@ -1,43 +1,96 @@
 #include "includes/PassCurses.hpp"
-#include "includes/PassCurses.cpp"
-#include "includes/json.hpp"
 
+using namespace PassCurses;
 
-int main()
+using JSON = nlohmann::json;
+
+
+int main(int argc, char *argv[])
 {
-    static const int CYPHER_KEY = set_key();
+    // '--compress' and '--plain' choose the format the vault is saved in from now on
+    // '--audit' prints the weak/reused password report and exits without starting the TUI
+    // '--import-breach <file>' builds the breach index from a dump of SHA-1 hashes and exits
+    // '--vault <name>' opens a named vault instead of the default one
+    auto storage_override = std::string();
+    auto headless_audit   = false;
+    for (auto i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        if (arg == "--compress" || arg == "--plain") storage_override = arg;
+        if (arg == "--audit") headless_audit = true;
+        if (arg == "--vault" && i + 1 < argc) {
+            if (!valid_vault_name(argv[i+1])) {
+                std::cerr << "INVALID VAULT NAME" << std::endl;
+                return EXIT_FAILURE;
+            }
+            select_vault(argv[++i]);
+        }
+        if (arg == "--import-breach" && i + 1 < argc) {
+            if (!import_breach_corpus(argv[i+1], breach_index_path())) return EXIT_FAILURE;
+            std::cout << "Breach index written to " << breach_index_path() << std::endl;
+            return 0;
+        }
+    }
 
-    static const std::string HOME_DIRECTORY = get_home_directory();
+    // Not const, switching vaults switches keys
+    auto CYPHER_KEY = set_key();
 
     if (!fs::exists(HOME_DIRECTORY + "/.passcurses")) create_data_directory(HOME_DIRECTORY);
-    if (!fs::exists(HOME_DIRECTORY + "/.passcurses/passrc")) create_rc(CYPHER_KEY);
-    if (!fs::exists(HOME_DIRECTORY + "/.passcurses/testing.json")) create_password_file(CYPHER_KEY);
+    if (!fs::exists(VAULT_DIRECTORY)) fs::create_directories(VAULT_DIRECTORY);
+    if (!fs::exists(passrc_path())) create_rc(CYPHER_KEY);
+    if (!fs::exists(vault_file_path())) create_password_file(CYPHER_KEY);
 
     if (!authenticate(CYPHER_KEY)) return 0;
 
-    JSON j = open_password_file(CYPHER_KEY);
+    // The warm-start cache replaces parsing the vault and sorting the frecency order,
+    // as long as neither file changed since it was written
+    JSON j;
+    USAGE_INDEX.load(usage_file_path(), CYPHER_KEY);
+    const auto warm_start = storage_override.empty() && load_warm_cache(CYPHER_KEY, j, USAGE_INDEX);
+    if (!warm_start) {
+        j = open_password_file(CYPHER_KEY);
+        if (!storage_override.empty()) {
+            COMPRESSED_STORAGE = (storage_override == "--compress");
+            write_to_file(j, CYPHER_KEY);
+        }
+        USAGE_INDEX.sync(j);
+    }
+    GROUP_TREE.load(groups_file_path());
+    GROUP_TREE.sync(j);
+    BREACH_INDEX.open(breach_index_path());
+
+    if (headless_audit) {
+        const auto report = audit_vault(j, CYPHER_KEY, &BREACH_INDEX);
+        for (auto &line : format_audit_report(report, CYPHER_KEY)) std::cout << line << '\n';
+        return 0;
+    }
 
     initialize_ncurses();
     WINDOW *password_win = initialize_ncurses_window();
 
-    auto j_compare = j.size();
+    VaultCache unlocked_vaults;  // Vaults switched away from, kept unlocked
+
+    auto j_compare = static_cast<int>(view_size(j));  // Rows in the current view, groups and filters included
     auto choice    = 0;      // char is too small to hold curses KEY values
     auto decrypted = false;  // tracking whether a password has been decrypted
     auto is_copied = false;  // tracking whether a password has been copied
-    auto helped    = false;  // tracking whether help has been printed
     auto highlight = 1;      // which password to highlight
+    auto status    = std::string();  // what the last delete, undo or redo did, shown until the next key
 
     print_passwords(password_win, highlight, j, CYPHER_KEY, decrypted, is_copied);
+    // Rebuild a stale or missing cache now that the first screen is up
+    if (!warm_start) WARM_CACHE_BUILDER.start(j, USAGE_INDEX, CYPHER_KEY);
     for (;;) {
         is_copied = false;
         choice = getch();
+        if (!status.empty()) {
+            move(LAYOUT.prompt_row, LAYOUT.prompt_col);
+            clrtoeol();
+            status.clear();
+        }
         switch(choice) {
-            case KEY_RESIZE: {
-                const auto [newY, newX] = resize_redraw();
-                password_win = newwin(HEIGHT, WIDTH, newY, newX);
-                wbkgdset(password_win, COLOR_PAIR(1));
+            case KEY_RESIZE:
+                resize_redraw(password_win);
                 break;
-            }
             case KEY_DOWN:
             case 106:
                 if (highlight == j_compare+1) highlight = 2;
@@ -64,48 +117,136 @@ int main()
                 highlight = (j_compare / 2) + 2;
                 break;
             // Delete a password
-            case 'D':
-                if (delete_password_entry(j, highlight, CYPHER_KEY)) j_compare--;
+            case 'D': {
+                const auto key = key_at_highlight(j, highlight);
+                if (delete_password_entry(j, highlight, CYPHER_KEY)) {
+                    status = "'" + decrypt(key, CYPHER_KEY) + "' deleted, 'u' to undo";
+                }
+                break;
+            }
+            // Undo the last change
+            case 'u':
+                status = undo_last_change(j, highlight, CYPHER_KEY, false);
+                break;
+            // Redo the last undone change
+            case 18:  // ctrl-r
+                status = undo_last_change(j, highlight, CYPHER_KEY, true);
                 break;
             // Decrypt/encrypt a password
-            case 'd':
+            case 'd': {
                 decrypted = !decrypted;
+                const auto key = key_at_highlight(j, highlight);
+                if (decrypted && !key.empty()) {
+                    USAGE_INDEX.touch(key);
+                    highlight = position_of(j, key) + 2;
+                }
                 break;
+            }
             // Copy a password
-            case 'c':
+            case 'c': {
+                const auto key = key_at_highlight(j, highlight);
                 copy_password_to_clipboard(j, highlight, CYPHER_KEY);
+                if (!key.empty()) highlight = position_of(j, key) + 2;  // Follow the entry if it moved up
                 is_copied = true;
                 break;
+            }
             // Add a password
             case 'a':
-                // Adding a password necessarily increases the number of passwords
-                // so the 'size' tracking variable needs to be incremented
-                if (add_password(j, password_win, CYPHER_KEY)) j_compare++;
+                add_password(j, password_win, CYPHER_KEY);
                 break;
             // Generate a random password
             case 'r':
-                if (new_random_password(j, password_win, CYPHER_KEY)) j_compare++;
-                write_to_file(j);
+                new_random_password(j, password_win, CYPHER_KEY);
                 break;
             // Search for a password key
             case '/':
                 highlight = search_for_password(j, highlight, CYPHER_KEY);
                 break;
+            // Show and restore previous versions of a password
+            case 'H':
+                show_history(j, password_win, highlight, CYPHER_KEY);
+                clear();
+                break;
+            // Toggle between key order and most frequently/recently used first
+            case 'o':
+                USAGE_INDEX.enabled = !USAGE_INDEX.enabled;
+                highlight = 2;
+                break;
+            // Audit the whole vault for reused and weak passwords
+            case 'A': {
+                const auto report = audit_vault(j, CYPHER_KEY, &BREACH_INDEX);
+                for (auto& [key, occurrences] : report.breached) BREACH_CHECKER.mark(key, occurrences);
+                show_report(password_win, "AUDIT", format_audit_report(report, CYPHER_KEY));
+                clear();
+                break;
+            }
+            // Switch to another vault
+            case 'V':
+                if (switch_vault(j, CYPHER_KEY, unlocked_vaults)) {
+                    highlight = 1;
+                    decrypted = false;
+                }
+                clear();
+                break;
+            // Toggle the group tree
+            case 't':
+                GROUP_TREE.enabled = !GROUP_TREE.enabled;
+                highlight = 2;
+                break;
+            // Open or close the highlighted group
+            case ' ':
+            case '\n':
+                if (tree_view_active()) GROUP_TREE.toggle(highlight - 2);
+                break;
+            // Edit the highlighted entry's group and tags
+            case 'e':
+                edit_groups(j, highlight, CYPHER_KEY);
+                break;
+            // Show only entries with one tag
+            case '#':
+                filter_by_tag(CYPHER_KEY);
+                highlight = 2;
+                break;
+            // Show the highlighted entry's username, url, notes and TOTP code
+            case 'i':
+                show_entry(j, password_win, highlight, CYPHER_KEY);
+                clear();
+                break;
+            // Copy the username
+            case 'U':
+                is_copied = copy_field_to_clipboard(j, highlight, Field::Username, CYPHER_KEY);
+                break;
+            // Copy the current TOTP code
+            case 'T':
+                is_copied = copy_field_to_clipboard(j, highlight, Field::TotpSeed, CYPHER_KEY);
+                break;
             // Show the help lines
             case 'h':
-                helped = print_help_message(helped);
+                print_help_message(password_win);
+                clear();
                 break;
             default:
                 print_passwords(password_win, highlight, j, CYPHER_KEY, decrypted, is_copied);
         }
+        j_compare = static_cast<int>(view_size(j));
         print_passwords(password_win, highlight, j, CYPHER_KEY, decrypted, is_copied);
+        if (!status.empty()) mvprintw(LAYOUT.prompt_row, LAYOUT.prompt_col, "%s", status.c_str());
         wrefresh(password_win);
         refresh();
         if (choice == 'q') break;
     }
 
+    USAGE_INDEX.save(usage_file_path(), CYPHER_KEY);
+    GROUP_TREE.save(groups_file_path());
+    compact_vault(j, CYPHER_KEY);
+
+    delwin(password_win);
     clear();
     endwin();
 
+    // Files are final now, so the next start can skip straight to the first screen
+    WARM_CACHE_BUILDER.wait();
+    save_warm_cache(j, USAGE_INDEX, CYPHER_KEY);
+
     return 0;
 }